@@ -0,0 +1,168 @@
+#include "AsyncCapture.h"
+
+#include <algorithm>
+
+AsyncCapture::AsyncCapture(uint workerCount)
+{
+    workerCount = std::max(workerCount, 1u);
+    for (uint i = 0; i < workerCount; ++i)
+        mWorkers.emplace_back([this]() { workerLoop(); });
+}
+
+AsyncCapture::~AsyncCapture()
+{
+    // the staging buffers belong to the device, they are read back while it's still alive in SDFRenderer::onShutdown
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mJobAdded.notify_all();
+    for (auto& t : mWorkers)
+        t.join();
+}
+
+void AsyncCapture::capture(
+    RenderContext* pContext,
+    const ref<Texture>& pTexture,
+    const std::filesystem::path& path,
+    Bitmap::FileFormat format,
+    Bitmap::ExportFlags exportFlags
+)
+{
+    if (!pTexture) return;
+
+    // same as Texture::captureToFile: the encoder needs at least 3 channels of HDR data
+    ref<Texture> pSource = pTexture;
+    ResourceFormat resourceFormat = pTexture->getFormat();
+    if (getFormatType(resourceFormat) == FormatType::Float && getFormatChannelCount(resourceFormat) < 3) {
+        pSource = pContext->getDevice()->createTexture2D(
+            pTexture->getWidth(), pTexture->getHeight(), ResourceFormat::RGBA32Float, 1, 1, nullptr,
+            ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource
+        );
+        pContext->blit(pTexture->getSRV(0, 1, 0, 1), pSource->getRTV(0, 0, 1));
+        resourceFormat = ResourceFormat::RGBA32Float;
+    }
+
+    // back-pressure, the ring of staging buffers is full
+    if (mReadbacks.size() >= kMaxPendingReadbacks) {
+        ++mForcedReadbackCount;
+        resolve(mReadbacks.front());
+        mReadbacks.pop_front();
+    }
+
+    Readback r;
+    r.pTask = pContext->asyncReadTextureSubresource(pSource.get(), pSource->getSubresourceIndex(0, 0));
+    r.frame = mFrame;
+    r.path = path;
+    r.format = format;
+    r.exportFlags = exportFlags;
+    r.resourceFormat = resourceFormat;
+    r.width = pSource->getWidth();
+    r.height = pSource->getHeight();
+    mReadbacks.push_back(std::move(r));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPendingPaths.push_back(path);
+}
+
+void AsyncCapture::endFrame()
+{
+    ++mFrame;
+    while (!mReadbacks.empty() && mReadbacks.front().frame + kReadbackLatency <= mFrame) {
+        resolve(mReadbacks.front());
+        mReadbacks.pop_front();
+    }
+}
+
+void AsyncCapture::flush()
+{
+    for (auto& r : mReadbacks)
+        resolve(r);
+    mReadbacks.clear();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJobDone.wait(lock, [this]() { return mJobs.empty() && mActiveJobs == 0; });
+}
+
+bool AsyncCapture::isPending(const std::filesystem::path& path) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return std::find(mPendingPaths.begin(), mPendingPaths.end(), path) != mPendingPaths.end();
+}
+
+void AsyncCapture::resolve(Readback& readback)
+{
+    EncodeJob job;
+    // waits for the fence of the copy, it's normally signaled by now
+    job.data = readback.pTask->getData();
+    job.path = std::move(readback.path);
+    job.format = readback.format;
+    job.exportFlags = readback.exportFlags;
+    job.resourceFormat = readback.resourceFormat;
+    job.width = readback.width;
+    job.height = readback.height;
+    readback.pTask = nullptr;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mJobs.size() >= kMaxQueuedImages) {
+        ++mQueueWaitCount;
+        mJobDone.wait(lock, [this]() { return mJobs.size() < kMaxQueuedImages; });
+    }
+    mJobs.push_back(std::move(job));
+    lock.unlock();
+    mJobAdded.notify_one();
+}
+
+void AsyncCapture::workerLoop()
+{
+    while (true) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJobAdded.wait(lock, [this]() { return mStop || !mJobs.empty(); });
+        // the remaining jobs are written before stopping
+        if (mJobs.empty()) return;
+        EncodeJob job = std::move(mJobs.front());
+        mJobs.pop_front();
+        ++mActiveJobs;
+        lock.unlock();
+        mJobDone.notify_all();
+
+        std::string error;
+        try {
+            Bitmap::saveImage(job.path, job.width, job.height, job.format, job.exportFlags, job.resourceFormat, true, job.data.data());
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+        }
+
+        lock.lock();
+        --mActiveJobs;
+        auto it = std::find(mPendingPaths.begin(), mPendingPaths.end(), job.path);
+        if (it != mPendingPaths.end()) mPendingPaths.erase(it);
+        if (error.empty()) {
+            ++mWrittenCount;
+        }
+        else {
+            ++mFailedCount;
+            mLastError = "[AsyncCapture] " + job.path.string() + ": " + error;
+        }
+        lock.unlock();
+        mJobDone.notify_all();
+    }
+}
+
+void AsyncCapture::renderGui(Gui::Widgets& w)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    w.text("Captures written: " + std::to_string(mWrittenCount) + ", in flight: " + std::to_string(mPendingPaths.size()));
+    w.tooltip(
+        "Read back " + std::to_string(kReadbackLatency) + " frames after the capture, encoded by " +
+        std::to_string(mWorkers.size()) + " worker threads"
+    );
+    if (mForcedReadbackCount > 0 || mQueueWaitCount > 0) {
+        w.text("Stalls: " + std::to_string(mForcedReadbackCount) + " full ring, " + std::to_string(mQueueWaitCount) + " full queue");
+    }
+    if (mFailedCount > 0) {
+        w.text("Failed: " + std::to_string(mFailedCount));
+        w.tooltip(mLastError);
+    }
+}
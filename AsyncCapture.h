@@ -0,0 +1,89 @@
+#pragma once
+#include "Falcor.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace Falcor;
+
+// Non-blocking texture to image file export.
+// capture() only records the copy of the texture into a staging buffer, the buffer is read back kReadbackLatency
+// frames later in endFrame() when the GPU is done with it, and the image is encoded and written by worker threads.
+// Back-pressure: if more than kMaxPendingReadbacks copies are in flight the oldest one is read back right away,
+// if kMaxQueuedImages images are waiting for the workers the render thread waits for a free slot.
+class AsyncCapture {
+public:
+    static constexpr uint kReadbackLatency = 3;
+    static constexpr uint kMaxPendingReadbacks = 8;
+    static constexpr uint kMaxQueuedImages = 16;
+    static constexpr uint kDefaultWorkerCount = 2;
+
+    explicit AsyncCapture(uint workerCount = kDefaultWorkerCount);
+    ~AsyncCapture();
+    AsyncCapture(const AsyncCapture&) = delete;
+    AsyncCapture& operator=(const AsyncCapture&) = delete;
+
+    // like Texture::captureToFile of mip 0, array slice 0
+    void capture(
+        RenderContext* pContext,
+        const ref<Texture>& pTexture,
+        const std::filesystem::path& path,
+        Bitmap::FileFormat format = Bitmap::FileFormat::PngFile,
+        Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None
+    );
+    // call once per frame, reads back the copies that are old enough
+    void endFrame();
+    // waits until every capture is written to the disk
+    void flush();
+
+    // the file is requested but not written yet
+    bool isPending(const std::filesystem::path& path) const;
+
+    void renderGui(Gui::Widgets& w);
+
+private:
+    struct Readback {
+        CopyContext::ReadTextureTask::SharedPtr pTask;
+        uint64_t frame;
+        std::filesystem::path path;
+        Bitmap::FileFormat format;
+        Bitmap::ExportFlags exportFlags;
+        ResourceFormat resourceFormat;
+        uint width;
+        uint height;
+    };
+    struct EncodeJob {
+        std::vector<uint8_t> data;
+        std::filesystem::path path;
+        Bitmap::FileFormat format;
+        Bitmap::ExportFlags exportFlags;
+        ResourceFormat resourceFormat;
+        uint width;
+        uint height;
+    };
+
+    // getData() of the staging buffer and hands it to the workers
+    void resolve(Readback& readback);
+    void workerLoop();
+
+    uint64_t mFrame = 0;
+    std::deque<Readback> mReadbacks; // render thread only, oldest first
+
+    mutable std::mutex mMutex;
+    std::condition_variable mJobAdded;
+    std::condition_variable mJobDone;
+    std::deque<EncodeJob> mJobs;
+    std::vector<std::filesystem::path> mPendingPaths; // captured but not written
+    uint mActiveJobs = 0;
+    bool mStop = false;
+    std::vector<std::thread> mWorkers;
+
+    // statistics
+    uint mWrittenCount = 0;
+    uint mFailedCount = 0;
+    uint mForcedReadbackCount = 0;   // the ring was full
+    uint mQueueWaitCount = 0;        // the render thread waited for the workers
+    std::string mLastError;
+};
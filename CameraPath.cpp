@@ -0,0 +1,63 @@
+#include "CameraPath.h"
+
+#include <cstring>
+#include <fstream>
+
+bool CameraPath::write(const std::filesystem::path& path, std::string& error) const
+{
+    CameraPathHeader header{};
+    std::memcpy(header.magic, kCameraPathMagic, sizeof(header.magic));
+    header.version = kCameraPathVersion;
+    header.frameCount = (uint32_t)frames.size();
+    header.frameTime = frameTime;
+
+    std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+    if (!fout) {
+        error = "couldn't open " + path.string() + " for writing";
+        return false;
+    }
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(CameraPathFrame));
+    if (!fout) {
+        error = "couldn't write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+bool CameraPath::read(const std::filesystem::path& path, std::string& error)
+{
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin) {
+        error = "couldn't open " + path.string();
+        return false;
+    }
+    CameraPathHeader header{};
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!fin || std::memcmp(header.magic, kCameraPathMagic, sizeof(header.magic)) != 0) {
+        error = path.string() + " is not a camera path file";
+        return false;
+    }
+    if (header.version != kCameraPathVersion) {
+        error = "unsupported camera path version " + std::to_string(header.version) + ", expected " + std::to_string(kCameraPathVersion);
+        return false;
+    }
+    // check the size before allocating the frames
+    const auto dataStart = fin.tellg();
+    fin.seekg(0, std::ios::end);
+    const uint64_t remaining = uint64_t(fin.tellg() - dataStart);
+    fin.seekg(dataStart);
+    if (remaining < uint64_t(header.frameCount) * sizeof(CameraPathFrame)) {
+        error = path.string() + " is truncated";
+        return false;
+    }
+    std::vector<CameraPathFrame> loaded(header.frameCount);
+    fin.read(reinterpret_cast<char*>(loaded.data()), loaded.size() * sizeof(CameraPathFrame));
+    if (!fin) {
+        error = path.string() + " is truncated";
+        return false;
+    }
+    frames = std::move(loaded);
+    frameTime = header.frameTime;
+    return true;
+}
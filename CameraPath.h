@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Utils/Math/Vector.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace Falcor;
+
+// Recorded camera motion, one pose per rendered frame, see SDFRenderer::FlythroughTester.
+//
+// Layout (little endian):
+//   CameraPathHeader
+//   CameraPathFrame[header.frameCount]
+//
+// Bump kCameraPathVersion whenever the layout changes, older versions are rejected.
+constexpr char kCameraPathMagic[8] = { 'S', 'D', 'F', 'C', 'P', 'A', 'T', 'H' };
+constexpr uint32_t kCameraPathVersion = 1;
+
+struct CameraPathHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t frameCount;
+    float frameTime;            // mean seconds between the recorded frames, the playback is frame locked
+};
+static_assert(std::is_trivially_copyable_v<CameraPathHeader>, "CameraPathHeader is written as raw bytes");
+
+struct CameraPathFrame {
+    float3 position;
+    float3 target;
+    float3 up;
+    float focalLength;
+};
+static_assert(std::is_trivially_copyable_v<CameraPathFrame> && sizeof(CameraPathFrame) == 40, "CameraPathFrame is written as raw bytes");
+
+class CameraPath {
+public:
+    std::vector<CameraPathFrame> frames;
+    float frameTime = 0.f;
+
+    // returns false and sets `error` on failure
+    bool write(const std::filesystem::path& path, std::string& error) const;
+    // returns false and sets `error` on failure
+    bool read(const std::filesystem::path& path, std::string& error);
+};
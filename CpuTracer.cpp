@@ -0,0 +1,1089 @@
+#include "CpuTracer.h"
+#include "CpuTracerPacket.h"
+#include "SDFFile.h"
+#include "Utils/Math/Float16.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace cpu_trace
+{
+namespace
+{
+// HLSL intrinsics used by the shaders
+float lerp(float a, float b, float t) { return a + t * (b - a); }
+float sign(float x) { return x > 0.f ? 1.f : (x < 0.f ? -1.f : 0.f); }
+float3 sign(float3 v) { return float3(sign(v.x), sign(v.y), sign(v.z)); }
+float3 mod(float3 x, float y) { return x - y * floor(x / y); }
+
+// Shaders/SDFScenes/primitives.slang
+float box(float3 p, float3 size)
+{
+    float3 d = abs(p) - size;
+    return std::min(std::max(d.x, std::max(d.y, d.z)), 0.0f) + length(max(d, float3(0.f)));
+}
+float cylinderY(float3 p, float2 h)
+{
+    float2 d = abs(float2(length(float2(p.x, p.z)), std::abs(p.y))) - h;
+    return std::min(std::max(d.x, d.y), 0.0f) + length(max(d, float2(0.f)));
+}
+
+// Shaders/SDFScenes/sphere.slang
+float sphereScene(float3 p)
+{
+    return length(p - 0.5f) - .25f;
+}
+// Shaders/SDFScenes/spheres.slang
+float spheresScene(float3 p)
+{
+    p = mod(p, 1.0f);
+    return length(p - 0.5f) - .35f;
+}
+// Shaders/SDFScenes/sdf_3.slang
+float sdf3Scene(float3 p)
+{
+    float r0 = box(p, float3(0.5f, 0.3f, 0.5f));
+    const float3 holes[] = {
+        float3(-0.5f, 0, -0.5f), float3(0.5f, 0, -0.5f), float3(-0.5f, 0, 0.5f), float3(0.5f, 0, 0.5f),
+    };
+    for (const auto& c : holes)
+        r0 = std::max(r0, -cylinderY(p - c, float2(0.2f, 0.6f)));
+    const float3 smallHoles[] = {
+        float3(-0.22f, 0, -0.42f), float3(0.42f, 0, -0.22f), float3(-0.42f, 0, 0.22f), float3(0.22f, 0, 0.42f),
+    };
+    for (const auto& c : smallHoles)
+        r0 = std::max(r0, -cylinderY(p - c, float2(0.04f, 0.6f)));
+    float r9 = cylinderY(p - float3(0, 0.5f, 0), float2(0.3f, 0.12f));
+    r9 = std::min(r9, cylinderY(p - float3(0, 0.32f, 0), float2(0.3f, 0.02f)));
+    r9 = std::min(r9, cylinderY(p - float3(0, 0.68f, 0), float2(0.3f, 0.02f)));
+    r9 = std::min(r9, cylinderY(p - float3(0, 0.5f, 0), float2(0.255f, 0.2f)));
+    r9 = std::max(r9, -cylinderY(p - float3(0, 0.64f, 0), float2(0.18f, 0.064f)));
+    r9 = std::max(r9, -cylinderY(p - float3(0, 0.36f, 0), float2(0.18f, 0.064f)));
+    r9 = std::max(r9, -cylinderY(p - float3(0, 0.5f, 0), float2(0.126f, 0.2f)));
+    return std::min(r0, r9);
+}
+}
+
+Model Model::create(float3 boxCorner, float3 boxSize, uint3 resolution)
+{
+    // BBox::calcInnerBox
+    const float3 res_r = 1.0f / float3(resolution);
+    Model m;
+    m.innerBoxCorner = boxCorner + 0.5f * res_r * boxSize;
+    m.innerBoxSize = boxSize * (1.0f - res_r);
+    m.outerBoxCorner = boxCorner;
+    m.outerBoxSize = boxSize;
+    m.oneOverOuterBoxSize = 1.0f / boxSize;
+    m.resolution = resolution;
+    return m;
+}
+
+GridSource::GridSource(uint3 resolution, std::vector<float> values)
+    : mResolution(resolution), mValues(std::move(values))
+{
+    mValues.resize((size_t)resolution.x * resolution.y * resolution.z, 0.f);
+}
+
+float GridSource::texel(int3 i) const
+{
+    const int x = std::clamp(i.x, 0, (int)mResolution.x - 1);
+    const int y = std::clamp(i.y, 0, (int)mResolution.y - 1);
+    const int z = std::clamp(i.z, 0, (int)mResolution.z - 1);
+    return mValues[(size_t)x + (size_t)y * mResolution.x + (size_t)z * mResolution.x * mResolution.y];
+}
+
+float GridSource::sample(float3 x) const
+{
+    // texel centers are at (i + 0.5) / resolution
+    const float3 u = x * float3(mResolution) - 0.5f;
+    const float3 i0 = floor(u);
+    const float3 f = u - i0;
+    const int3 i(i0);
+    const float c000 = texel(i);
+    const float c100 = texel(i + int3(1, 0, 0));
+    const float c010 = texel(i + int3(0, 1, 0));
+    const float c110 = texel(i + int3(1, 1, 0));
+    const float c001 = texel(i + int3(0, 0, 1));
+    const float c101 = texel(i + int3(1, 0, 1));
+    const float c011 = texel(i + int3(0, 1, 1));
+    const float c111 = texel(i + int3(1, 1, 1));
+    const float c00 = lerp(c000, c100, f.x);
+    const float c10 = lerp(c010, c110, f.x);
+    const float c01 = lerp(c001, c101, f.x);
+    const float c11 = lerp(c011, c111, f.x);
+    return lerp(lerp(c00, c10, f.y), lerp(c01, c11, f.y), f.z);
+}
+
+bool GridSource::gradient(float3 x, float3& grad) const
+{
+    const float3 u = x * float3(mResolution) - 0.5f;
+    const float3 i0 = floor(u);
+    const float3 f = u - i0;
+    const int3 i(i0);
+    const float c000 = texel(i);
+    const float c100 = texel(i + int3(1, 0, 0));
+    const float c010 = texel(i + int3(0, 1, 0));
+    const float c110 = texel(i + int3(1, 1, 0));
+    const float c001 = texel(i + int3(0, 0, 1));
+    const float c101 = texel(i + int3(1, 0, 1));
+    const float c011 = texel(i + int3(0, 1, 1));
+    const float c111 = texel(i + int3(1, 1, 1));
+    // derivatives in index space
+    grad.x = lerp(lerp(c100 - c000, c110 - c010, f.y), lerp(c101 - c001, c111 - c011, f.y), f.z);
+    grad.y = lerp(lerp(c010 - c000, c110 - c100, f.x), lerp(c011 - c001, c111 - c101, f.x), f.z);
+    grad.z = lerp(lerp(c001 - c000, c101 - c100, f.x), lerp(c011 - c010, c111 - c110, f.x), f.y);
+    grad *= float3(mResolution);
+    return true;
+}
+
+std::unique_ptr<GridSource> createGridSource(const SDFFile& file, Model& model, std::string& error)
+{
+    const auto& h = file.header;
+    if (h.sdfType != 0) { // SDF_Type::SDF0
+        error = "not an SDF0 file";
+        return nullptr;
+    }
+    const int index = file.findTexture(SDFFileTextureRole::Texture);
+    const uint8_t* pData = index < 0 ? nullptr : file.getPayload(index);
+    if (!pData) {
+        error = "the file has no SDF texture";
+        return nullptr;
+    }
+    const auto& tex = file.textures[index];
+    const uint3 res{ tex.width, tex.height, tex.depth };
+    std::vector<float> values((size_t)res.x * res.y * res.z);
+    switch ((SDFFileFormat)tex.format)
+    {
+    case SDFFileFormat::R32Float:
+        std::memcpy(values.data(), pData, values.size() * sizeof(float));
+        break;
+    case SDFFileFormat::R16Float:
+        for (size_t i = 0; i < values.size(); ++i) {
+            uint16_t bits;
+            std::memcpy(&bits, pData + 2 * i, sizeof(bits));
+            values[i] = float16ToFloat32(bits);
+        }
+        break;
+    default:
+        error = "unsupported texture format";
+        return nullptr;
+    }
+    model = Model::create(
+        float3(h.boxCorner[0], h.boxCorner[1], h.boxCorner[2]),
+        float3(h.boxSize[0], h.boxSize[1], h.boxSize[2]),
+        uint3(h.resolution[0], h.resolution[1], h.resolution[2]));
+    return std::make_unique<GridSource>(res, std::move(values));
+}
+
+HermiteGridSource::HermiteGridSource(uint3 resolution, std::vector<float4> values, float3 cellSize)
+    : mResolution(resolution), mValues(std::move(values)), mCellSize(cellSize)
+{
+    mValues.resize((size_t)resolution.x * resolution.y * resolution.z, float4(0.f));
+}
+
+const float4& HermiteGridSource::texel(int3 i) const
+{
+    const int x = std::clamp(i.x, 0, (int)mResolution.x - 1);
+    const int y = std::clamp(i.y, 0, (int)mResolution.y - 1);
+    const int z = std::clamp(i.z, 0, (int)mResolution.z - 1);
+    return mValues[(size_t)x + (size_t)y * mResolution.x + (size_t)z * mResolution.x * mResolution.y];
+}
+
+namespace
+{
+// hermiteWeights in Shaders/hermite.slang
+float4 hermiteWeights(float t)
+{
+    const float s = 1.f - t;
+    return float4((1.f + 2.f * t) * s * s, t * t * (3.f - 2.f * t), t * s * s, -t * t * s);
+}
+}
+
+float HermiteGridSource::sample(float3 x) const
+{
+    const float3 u = clamp(x * float3(mResolution) - 0.5f, float3(0.f), float3(mResolution - 1u));
+    const int3 i0 = max(min(int3(u), int3(mResolution) - 2), int3(0));
+    const float3 t = u - float3(i0);
+    float4 wx = hermiteWeights(t.x);
+    float4 wy = hermiteWeights(t.y);
+    float4 wz = hermiteWeights(t.z);
+    wx.z *= mCellSize.x; wx.w *= mCellSize.x;
+    wy.z *= mCellSize.y; wy.w *= mCellSize.y;
+    wz.z *= mCellSize.z; wz.w *= mCellSize.z;
+
+    float d = 0.f;
+    for (uint c = 0; c < 8; ++c) {
+        const int3 o(c & 1, (c >> 1) & 1, c >> 2);
+        const float4& v = texel(i0 + o);
+        const float3 b(wx[o.x], wy[o.y], wz[o.z]);
+        const float3 g(wx[o.x + 2], wy[o.y + 2], wz[o.z + 2]);
+        d += b.x * b.y * b.z * v.x + g.x * b.y * b.z * v.y + b.x * g.y * b.z * v.z + b.x * b.y * g.z * v.w;
+    }
+    return d;
+}
+
+std::unique_ptr<HermiteGridSource> createHermiteGridSource(const SDFFile& file, Model& model, std::string& error)
+{
+    const auto& h = file.header;
+    if (h.sdfType != 3) { // SDF_Type::SDF1
+        error = "not an SDF1 file";
+        return nullptr;
+    }
+    const int index = file.findTexture(SDFFileTextureRole::Texture);
+    const uint8_t* pData = index < 0 ? nullptr : file.getPayload(index);
+    if (!pData) {
+        error = "the file has no SDF texture";
+        return nullptr;
+    }
+    const auto& tex = file.textures[index];
+    const uint3 res{ tex.width, tex.height, tex.depth };
+    std::vector<float4> values((size_t)res.x * res.y * res.z);
+    switch ((SDFFileFormat)tex.format)
+    {
+    case SDFFileFormat::RGBA32Float:
+        std::memcpy(values.data(), pData, values.size() * sizeof(float4));
+        break;
+    case SDFFileFormat::RGBA16Float:
+        for (size_t i = 0; i < values.size(); ++i) {
+            uint16_t bits[4];
+            std::memcpy(bits, pData + 8 * i, sizeof(bits));
+            values[i] = float4(float16ToFloat32(bits[0]), float16ToFloat32(bits[1]), float16ToFloat32(bits[2]), float16ToFloat32(bits[3]));
+        }
+        break;
+    default:
+        error = "unsupported texture format";
+        return nullptr;
+    }
+    model = Model::create(
+        float3(h.boxCorner[0], h.boxCorner[1], h.boxCorner[2]),
+        float3(h.boxSize[0], h.boxSize[1], h.boxSize[2]),
+        uint3(h.resolution[0], h.resolution[1], h.resolution[2]));
+    return std::make_unique<HermiteGridSource>(res, std::move(values), model.outerBoxSize / float3(model.resolution));
+}
+
+QuantizedBrickSource::QuantizedBrickSource(uint3 resolution, std::vector<uint8_t> atlas, std::vector<float2> ranges)
+    : mResolution(resolution), mBrickGrid(max(resolution / kBrickSize, uint3(1))), mAtlasSize(mBrickGrid * kBrickTexels)
+    , mAtlas(std::move(atlas)), mRanges(std::move(ranges))
+{
+    mAtlas.resize((size_t)mAtlasSize.x * mAtlasSize.y * mAtlasSize.z, 0);
+    mRanges.resize((size_t)mBrickGrid.x * mBrickGrid.y * mBrickGrid.z, float2(0.f));
+}
+
+float QuantizedBrickSource::atlasTexel(int3 i) const
+{
+    const int x = std::clamp(i.x, 0, (int)mAtlasSize.x - 1);
+    const int y = std::clamp(i.y, 0, (int)mAtlasSize.y - 1);
+    const int z = std::clamp(i.z, 0, (int)mAtlasSize.z - 1);
+    return mAtlas[(size_t)x + (size_t)y * mAtlasSize.x + (size_t)z * mAtlasSize.x * mAtlasSize.y] * (1.f / 255.f);
+}
+
+float QuantizedBrickSource::sample(float3 x) const
+{
+    const float3 u = clamp(x * float3(mResolution) - 0.5f, float3(0.f), float3(mResolution - 1u));
+    const uint3 brick = min(uint3(u / float(kBrickSize)), mBrickGrid - 1u);
+    const float3 local = u - float3(brick * kBrickSize);
+    // trilinear filtering of the atlas, the texel centers are at the integer positions here
+    const float3 a = float3(brick * kBrickTexels) + local;
+    const float3 i0 = floor(a);
+    const float3 f = a - i0;
+    const int3 i(i0);
+    const float c00 = lerp(atlasTexel(i), atlasTexel(i + int3(1, 0, 0)), f.x);
+    const float c10 = lerp(atlasTexel(i + int3(0, 1, 0)), atlasTexel(i + int3(1, 1, 0)), f.x);
+    const float c01 = lerp(atlasTexel(i + int3(0, 0, 1)), atlasTexel(i + int3(1, 0, 1)), f.x);
+    const float c11 = lerp(atlasTexel(i + int3(0, 1, 1)), atlasTexel(i + int3(1, 1, 1)), f.x);
+    const float q = lerp(lerp(c00, c10, f.y), lerp(c01, c11, f.y), f.z);
+    const float2 range = mRanges[brick.x + (size_t)mBrickGrid.x * (brick.y + (size_t)mBrickGrid.y * brick.z)];
+    return range.x + range.y * q;
+}
+
+std::unique_ptr<QuantizedBrickSource> createQuantizedBrickSource(const SDFFile& file, Model& model, std::string& error)
+{
+    const auto& h = file.header;
+    if (h.sdfType != 4) { // SDF_Type::QuantizedBrick
+        error = "not a QuantizedBrick file";
+        return nullptr;
+    }
+    const int atlasIndex = file.findTexture(SDFFileTextureRole::Texture);
+    const int rangeIndex = file.findTexture(SDFFileTextureRole::BrickRange);
+    const uint8_t* pAtlas = atlasIndex < 0 ? nullptr : file.getPayload(atlasIndex);
+    const uint8_t* pRanges = rangeIndex < 0 ? nullptr : file.getPayload(rangeIndex);
+    if (!pAtlas || !pRanges) {
+        error = "the file has no brick atlas or brick range texture";
+        return nullptr;
+    }
+    const auto& atlasTex = file.textures[atlasIndex];
+    const auto& rangeTex = file.textures[rangeIndex];
+    if ((SDFFileFormat)atlasTex.format != SDFFileFormat::R8Unorm || (SDFFileFormat)rangeTex.format != SDFFileFormat::RG32Float) {
+        error = "unsupported texture format";
+        return nullptr;
+    }
+    const uint3 res(h.resolution[0], h.resolution[1], h.resolution[2]);
+    const uint3 brickGrid = res / QuantizedBrickSource::kBrickSize;
+    const uint3 atlasSize = brickGrid * QuantizedBrickSource::kBrickTexels;
+    if (atlasTex.width != atlasSize.x || atlasTex.height != atlasSize.y || atlasTex.depth != atlasSize.z
+        || rangeTex.width != brickGrid.x || rangeTex.height != brickGrid.y || rangeTex.depth != brickGrid.z) {
+        error = "the size of the bricks doesn't match the resolution";
+        return nullptr;
+    }
+    std::vector<uint8_t> atlas(pAtlas, pAtlas + (size_t)atlasSize.x * atlasSize.y * atlasSize.z);
+    std::vector<float2> ranges((size_t)brickGrid.x * brickGrid.y * brickGrid.z);
+    std::memcpy(ranges.data(), pRanges, ranges.size() * sizeof(float2));
+    model = Model::create(
+        float3(h.boxCorner[0], h.boxCorner[1], h.boxCorner[2]),
+        float3(h.boxSize[0], h.boxSize[1], h.boxSize[2]),
+        res);
+    return std::make_unique<QuantizedBrickSource>(res, std::move(atlas), std::move(ranges));
+}
+
+StepHintVolume::StepHintVolume(const DistanceSource& source, uint3 gridSize, float3 outerBoxSize, uint threadCount)
+    : mGridSize(max(gridSize, uint3(1))), mHints((size_t)mGridSize.x * mGridSize.y * mGridSize.z)
+{
+    constexpr uint S = kBrickSize + 1; // samples per brick side
+    const float3 latticeSize = float3(mGridSize * kBrickSize);
+    const float3 cellSize = outerBoxSize / latticeSize;
+
+    // stepHint_main, the bricks are distributed between the threads
+    std::vector<float4> undilated(mHints.size());
+    std::atomic<size_t> nextBrick{ 0 };
+    auto worker = [&]() {
+        std::vector<float> d(S * S * S);
+        for (size_t b = nextBrick++; b < undilated.size(); b = nextBrick++) {
+            const uint3 brick(uint(b % mGridSize.x), uint((b / mGridSize.x) % mGridSize.y), uint(b / ((size_t)mGridSize.x * mGridSize.y)));
+            for (uint s = 0; s < d.size(); ++s) {
+                const uint3 local(s % S, (s / S) % S, s / (S * S));
+                d[s] = source.sample(float3(brick * kBrickSize + local) / latticeSize);
+            }
+            float L = 0.f;
+            float3 dirSum(0.f);
+            for (uint c = 0; c < kBrickSize * kBrickSize * kBrickSize; ++c) {
+                const uint3 cell(c % kBrickSize, (c / kBrickSize) % kBrickSize, c / (kBrickSize * kBrickSize));
+                auto at = [&](uint k) { return d[(cell.x + (k & 1)) + S * ((cell.y + ((k >> 1) & 1)) + S * (cell.z + (k >> 2)))]; };
+                float3 g(0.f);
+                for (uint k = 0; k < 8; ++k) {
+                    const float3 e = float3(at(k | 1) - at(k & ~1u), at(k | 2) - at(k & ~2u), at(k | 4) - at(k & ~4u)) / cellSize;
+                    L = std::max(L, std::max(std::abs(e.x), std::max(std::abs(e.y), std::abs(e.z))));
+                    g += e;
+                }
+                if (dot(g, g) > 0.f)
+                    dirSum += normalize(g);
+            }
+            undilated[b] = float4(dirSum / float(kBrickSize * kBrickSize * kBrickSize), L);
+        }
+    };
+    const uint workerCount = threadCount != 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<std::thread> threads;
+    for (uint i = 0; i < workerCount; ++i)
+        threads.emplace_back(worker);
+    for (auto& th : threads)
+        th.join();
+
+    // stepHintDilate_main
+    const int3 grid(mGridSize);
+    for (int z = 0; z < grid.z; ++z)
+    for (int y = 0; y < grid.y; ++y)
+    for (int x = 0; x < grid.x; ++x) {
+        const size_t index = x + (size_t)grid.x * (y + (size_t)grid.y * z);
+        float L = undilated[index].w;
+        for (int dz = -1; dz <= 1; ++dz)
+        for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx) {
+            const int3 i(x + dx, y + dy, z + dz);
+            if (i.x >= 0 && i.y >= 0 && i.z >= 0 && i.x < grid.x && i.y < grid.y && i.z < grid.z)
+                L = std::max(L, undilated[i.x + (size_t)grid.x * (i.y + (size_t)grid.y * i.z)].w);
+        }
+        mHints[index] = float4(undilated[index].xyz(), L);
+    }
+}
+
+uint3 StepHintVolume::getBrick(float3 x) const
+{
+    return min(uint3(max(x * float3(mGridSize), float3(0.f))), mGridSize - 1u);
+}
+
+float StepHintVolume::slope(const float4& hint, float3 dir)
+{
+    const float3 g = hint.xyz();
+    return std::clamp(dot(dir, g) - (1.0f - length(g)), -1.0f, 0.5f);
+}
+
+std::unique_ptr<DistanceSource> createFileSource(const SDFFile& file, Model& model, std::string& error)
+{
+    switch (file.header.sdfType)
+    {
+    case 0: // SDF_Type::SDF0
+        return createGridSource(file, model, error);
+    case 3: // SDF_Type::SDF1
+        return createHermiteGridSource(file, model, error);
+    case 4: // SDF_Type::QuantizedBrick
+        return createQuantizedBrickSource(file, model, error);
+    default:
+        error = "only SDF0, SDF1 and QuantizedBrick files can be traced on the CPU";
+        return nullptr;
+    }
+}
+
+ProceduralSource::Function findProceduralFunction(const std::string& name)
+{
+    static const std::unordered_map<std::string, ProceduralSource::Function> kScenes = {
+        { "Sphere", sphereScene },
+        { "Spheres", spheresScene },
+        { "SDF3", sdf3Scene },
+    };
+    auto it = kScenes.find(name);
+    return it != kScenes.end() ? it->second : ProceduralSource::Function{};
+}
+
+TraceResult SDFTracer::traceClassic(Ray ray, const SphereTraceDesc& params) const
+{
+    // trace in local model coordinates
+    ray.orig -= mModel.outerBoxCorner;
+
+    TraceResult ret;
+    ret.T = ray.tMin;
+
+    int i = 0;
+    float dd = sdfInside(ray.orig + ret.T * ray.dir);
+    float prevSign = dd;
+    float prevT = ret.T;
+    for (; i < params.maxiters && dd > params.epsilon && ret.T < ray.tMax; ++i)
+    {
+        prevT = ret.T;
+        ret.T += dd;
+        ret.T = std::min(ret.T, ray.tMax);
+        prevSign = dd;
+        dd = sdfInside(ray.orig + ret.T * ray.dir);
+    }
+
+    if (dd <= params.epsilon && !params.shadowRay)
+    {
+        // linear approx == f(t) = f0 + t*(f1-f0) to reconstruct at t = 0 and t = 1
+        float f0 = prevSign;
+        float f1 = dd;
+        float t = (f0 - f1 == 0.0f) ? 1.0f : f0 / (f0 - f1);
+        ret.T = lerp(prevT, ret.T, t);
+        dd = lerp(f0, f1, t);
+    }
+
+    ret.backStep = 0;
+    ret.stepCount = (uint)i;
+    ret.flags = uint(ret.T >= ray.tMax)
+        | (uint(std::abs(dd) <= params.epsilon) << 1)
+        | (uint(i >= params.maxiters) << 2);
+    return ret;
+}
+
+TraceResult SDFTracer::traceRelaxed(Ray ray, const SphereTraceDesc& params) const
+{
+    ray.orig -= mModel.outerBoxCorner; // trace in local model coordinates
+    TraceResult ret;
+    ret.T = ray.tMin;
+    int i = 0;
+    float di = 0.f, ri = 0.f, ri1 = 0.f;
+    do
+    {
+        di = ri * (di == 0.f ? 1.f : params.stepRelaxation); // if d==0 we are stepping back
+        ri1 = sdfInside(ray.orig + (ret.T + di) * ray.dir); // single sdf eval at t + di
+        ++i;
+        if (di > ri + std::abs(ri1))
+        { // normal step can only occur after enhanced because di==ri when normal step
+            di = 0.f; // normal step next cycle
+            ret.backStep++;
+        }
+        else
+        { // rotate variables when relaxed stepping
+            ri = ri1;
+        }
+        ret.T += di;
+    } while (ret.T < ray.tMax          // miss
+        && ri > params.epsilon         // hit
+        && i < params.maxiters);       // didn't converge
+    ret.stepCount = (uint)i;
+    ret.T = std::min(ret.T, ray.tMax);
+    ret.flags = (uint(ret.T >= ray.tMax) << 0) // miss
+        | (uint(ri <= params.epsilon) << 1)    // hit
+        | (uint(i >= params.maxiters) << 2);   // didn't converge
+    return ret;
+}
+
+namespace
+{
+float enhanceSphereTraceStep(float di, float ri0, float ri, float relax)
+{
+    return relax * ri * (di - ri0 + ri) / std::max(di + ri0 - ri, 0.00001f);
+}
+float calcSlope(float t0, float t1, float r0, float r1)
+{
+    return (r1 - r0) / std::max(t1 - t0, 1e-5f);
+}
+}
+
+TraceResult SDFTracer::traceEnhanced(Ray ray, const SphereTraceDesc& params) const
+{
+    ray.orig -= mModel.outerBoxCorner; // trace in local model coordinates
+
+    TraceResult ret;
+    ret.T = ray.tMin;
+    int i = 0;
+    float di = 0.f, ri0 = 0.f, ri = 0.f, ri1 = 0.f;
+
+    do
+    {
+        di = ri + (di == 0.f ? 0.f : enhanceSphereTraceStep(di, ri0, ri, params.stepRelaxation)); // if d==0 we are stepping back
+
+        ri1 = sdfInside(ray.orig + (ret.T + di) * ray.dir); // single sdf eval at t + di
+        ++i;
+
+        if (di > ri + std::abs(ri1))
+        { // normal step can only occur after enhanced because di==ri when normal step
+            di = 0.f; // normal step next cycle
+            ret.backStep++;
+        }
+        else
+        { // rotate variables when enhanced stepping
+            ri0 = ri;
+            ri = ri1;
+        }
+        ret.T += di;
+    } while (ret.T < ray.tMax          // miss
+        && ri > params.epsilon         // hit
+        && i < params.maxiters);       // didn't converge
+
+    ret.stepCount = (uint)i;
+    ret.T = std::min(ret.T, ray.tMax);
+    ret.flags = (uint(ret.T >= ray.tMax) << 0) // miss
+        | (uint(ri <= params.epsilon) << 1)    // hit
+        | (uint(i >= params.maxiters) << 2);   // didn't converge
+    return ret;
+}
+
+TraceResult SDFTracer::traceAutoRelaxation(Ray ray, const SphereTraceDesc& params) const
+{
+    ray.orig -= mModel.outerBoxCorner; // trace in local model coordinates
+
+    TraceResult ret;
+    float t = ray.tMin;
+    float r = sdfInside(ray.orig + t * ray.dir);
+    int i = 1;
+    float z = r;
+    float m = -1;
+    while (t + r < ray.tMax          // miss
+        && r > params.epsilon        // hit
+        && i < params.maxiters)      // didn't converge
+    {
+        float T = t + z;
+        float R = sdfInside(ray.orig + T * ray.dir);
+        bool doBackStep = z > std::abs(R) + r;
+        float M = calcSlope(t, T, r, R);
+        m = doBackStep ? -1 : lerp(m, M, params.stepRelaxation);
+        t = doBackStep ? t : T;
+        r = doBackStep ? r : R;
+        float omega = std::max(1.0f, 2.0f / (1.0f - m));
+        z = std::max(params.epsilon, r * omega);
+        ++i;
+        ret.backStep += doBackStep ? 1 : 0;
+    }
+
+    ret.stepCount = (uint)i;
+    ret.T = t + r;
+    ret.T = std::min(ret.T, ray.tMax);
+    ret.flags = (uint(ret.T >= ray.tMax) << 0) // miss
+        | (uint(r <= params.epsilon) << 1)     // hit
+        | (uint(i >= params.maxiters) << 2);   // didn't converge
+    return ret;
+}
+
+TraceResult SDFTracer::traceHinted(Ray ray, const SphereTraceDesc& params) const
+{
+    ray.orig -= mModel.outerBoxCorner; // trace in local model coordinates
+
+    auto getBrick = [&](float t) { return mpStepHints ? mpStepHints->getBrick((ray.orig + t * ray.dir) * mModel.oneOverOuterBoxSize) : uint3(0); };
+    auto loadHint = [&](uint3 brick) { return mpStepHints ? mpStepHints->at(brick) : float4(0.f); };
+
+    TraceResult ret;
+    float t = ray.tMin;
+    uint3 brick = getBrick(t);
+    float4 hint = loadHint(brick);
+    float invLipschitz = 1.0f / std::max(hint.w, 1.0f);
+    float r = sdfInside(ray.orig + t * ray.dir) * invLipschitz;
+    int i = 1;
+    float m = StepHintVolume::slope(hint, ray.dir);
+    float z = r * std::max(1.0f, 2.0f / (1.0f - m));
+    while (t + r < ray.tMax          // miss
+        && r / invLipschitz > params.epsilon // hit
+        && i < params.maxiters)      // didn't converge
+    {
+        float T = t + z;
+        float R = sdfInside(ray.orig + T * ray.dir) * invLipschitz;
+        bool doBackStep = z > std::abs(R) + r;
+        float M = calcSlope(t, T, r, R);
+        m = doBackStep ? -1 : lerp(m, M, params.stepRelaxation);
+        t = doBackStep ? t : T;
+        r = doBackStep ? r : R;
+        if (!doBackStep) {
+            const uint3 nextBrick = getBrick(t);
+            if (nextBrick.x != brick.x || nextBrick.y != brick.y || nextBrick.z != brick.z) {
+                brick = nextBrick;
+                hint = loadHint(brick);
+                const float nextInvLipschitz = 1.0f / std::max(hint.w, 1.0f);
+                r *= nextInvLipschitz / invLipschitz;
+                invLipschitz = nextInvLipschitz;
+                m = std::min(m, StepHintVolume::slope(hint, ray.dir));
+            }
+        }
+        float omega = std::max(1.0f, 2.0f / (1.0f - m));
+        z = std::max(params.epsilon, r * omega);
+        ++i;
+        ret.backStep += doBackStep ? 1 : 0;
+    }
+
+    ret.stepCount = (uint)i;
+    ret.T = t + r;
+    ret.T = std::min(ret.T, ray.tMax);
+    ret.flags = (uint(ret.T >= ray.tMax) << 0) // miss
+        | (uint(r / invLipschitz <= params.epsilon) << 1) // hit
+        | (uint(i >= params.maxiters) << 2);   // didn't converge
+    return ret;
+}
+
+TraceResult SDFTracer::trace(int traceFunNum, const Ray& ray, const SphereTraceDesc& params) const
+{
+    switch (traceFunNum)
+    {
+    case 1:
+        return traceClassic(ray, params);
+    case 2:
+        return traceRelaxed(ray, params);
+    case 3:
+        return traceEnhanced(ray, params);
+    case 4:
+        return traceAutoRelaxation(ray, params);
+    case 7:
+        return traceHinted(ray, params);
+    default:
+        // 5 and 6 only run on the GPU, like the #error in trace.slang. Callers check hasTraceFunction,
+        // in release builds the ray is reported as not converged instead of silently using another tracer.
+        assert(!"SDFTracer::trace: trace function without a CPU port");
+        TraceResult ret;
+        ret.T = ray.tMax;
+        ret.flags = kTraceOutOfIters;
+        return ret;
+    }
+}
+
+bool SDFTracer::hasTraceFunction(int traceFunNum)
+{
+    return (traceFunNum >= 1 && traceFunNum <= 4) || traceFunNum == 7;
+}
+
+float3 SDFTracer::getNormalCentralDiff(float3 p, float3 eps) const
+{
+    const float3 plus(sdf(p + float3(eps.x, 0.f, 0.f)), sdf(p + float3(0.f, eps.y, 0.f)), sdf(p + float3(0.f, 0.f, eps.z)));
+    const float3 mins(sdf(p - float3(eps.x, 0.f, 0.f)), sdf(p - float3(0.f, eps.y, 0.f)), sdf(p - float3(0.f, 0.f, eps.z)));
+    return normalize((plus - mins) / eps);
+}
+
+float3 SDFTracer::getNormalForwardDiff(float3 p, float3 eps) const
+{
+    const float3 plus(sdf(p + float3(eps.x, 0.f, 0.f)), sdf(p + float3(0.f, eps.y, 0.f)), sdf(p + float3(0.f, 0.f, eps.z)));
+    return normalize((plus - sdf(p)) / eps);
+}
+
+float3 SDFTracer::getNormalTetrahedral(float3 p, float3 eps) const
+{
+    const float3 k0(1.f, -1.f, -1.f), k1(-1.f, -1.f, 1.f), k2(-1.f, 1.f, -1.f), k3(1.f, 1.f, 1.f);
+    const float3 sum = k0 * sdf(p + k0 * eps) + k1 * sdf(p + k1 * eps) + k2 * sdf(p + k2 * eps) + k3 * sdf(p + k3 * eps);
+    return normalize(sum / eps);
+}
+
+float3 SDFTracer::getNormalAnalytic(float3 p, float3 eps) const
+{
+    float3 grad;
+    if (mSource.gradient((p - mModel.outerBoxCorner) * mModel.oneOverOuterBoxSize, grad)) {
+        grad *= mModel.oneOverOuterBoxSize;
+        if (dot(grad, grad) > 0.f)
+            return normalize(grad);
+    }
+    return getNormalTetrahedral(p, eps);
+}
+
+float3 SDFTracer::getNormal(NormalMode mode, float3 p, float3 eps) const
+{
+    switch (mode)
+    {
+    case NormalMode::ForwardDiff:
+        return getNormalForwardDiff(p, eps);
+    case NormalMode::Analytic:
+        return getNormalAnalytic(p, eps);
+    default:
+        return getNormalCentralDiff(p, eps);
+    }
+}
+
+bool intersectBox(float3 boxCenter, float3 boxRadius, Ray ray, bool front, float& dist)
+{
+    // based on http://www.jcgt.org/published/0007/03/04/paper-lowres.pdf
+    ray.orig = ray.orig - boxCenter;
+    float winding = front ? 1.f : -1.f;
+    float3 sgn = -sign(ray.dir);
+    float3 d = boxRadius * winding * sgn - ray.orig;
+    d = d / ray.dir;
+    auto testBox = [&](float dU, float o1, float dir1, float r1, float o2, float dir2, float r2) {
+        return (dU >= 0.0f) && std::abs(o1 + dir1 * dU) < r1 && std::abs(o2 + dir2 * dU) < r2;
+    };
+    const bool testX = testBox(d.x, ray.orig.y, ray.dir.y, boxRadius.y, ray.orig.z, ray.dir.z, boxRadius.z);
+    const bool testY = testBox(d.y, ray.orig.z, ray.dir.z, boxRadius.z, ray.orig.x, ray.dir.x, boxRadius.x);
+    const bool testZ = testBox(d.z, ray.orig.x, ray.dir.x, boxRadius.x, ray.orig.y, ray.dir.y, boxRadius.y);
+    sgn = testX ? float3(sgn.x, 0, 0) : (testY ? float3(0, sgn.y, 0) : float3(0, 0, testZ ? sgn.z : 0));
+    dist = (sgn.x != 0) ? d.x : ((sgn.y != 0) ? d.y : d.z);
+    return (sgn.x != 0) || (sgn.y != 0) || (sgn.z != 0);
+}
+
+Ray getRay(const Model& model, float3 camPos, float3 wPos)
+{
+    const float3 worldVec = wPos - camPos;
+    const float wVecLen = length(worldVec);
+    Ray ray;
+    ray.orig = camPos;
+    ray.dir = worldVec / wVecLen;
+    ray.tMin = wVecLen;
+    if (!intersectBox(model.innerBoxCorner + 0.5f * model.innerBoxSize, 0.5f * model.innerBoxSize, ray, false, ray.tMax))
+    {
+        ray.tMax = ray.tMin - 1;
+    }
+    return ray;
+}
+
+float3 Camera::getRayDir(float2 pixel, uint2 frameSize) const
+{
+    const float3 forward = normalize(target - position);
+    const float3 right = normalize(cross(forward, up));
+    const float3 camUp = cross(right, forward);
+    const float tanHalfFov = std::tan(0.5f * fovY);
+    const float aspect = (float)frameSize.x / (float)frameSize.y;
+    const float ndcX = 2.f * pixel.x / (float)frameSize.x - 1.f;
+    const float ndcY = 1.f - 2.f * pixel.y / (float)frameSize.y;
+    return normalize(forward + (ndcX * tanHalfFov * aspect) * right + (ndcY * tanHalfFov) * camUp);
+}
+
+void ConvergenceCounts::add(const TraceResult& r)
+{
+    // same as doDebugWrites in Shaders/cube_main.ps.slang
+    const bool miss = r.flags & kTraceMiss;
+    const bool hit = r.flags & kTraceHit;
+    const bool outOfIters = (r.flags & kTraceOutOfIters) && !hit && !miss;
+    nonConvergedCount += outOfIters ? 1 : 0;
+    convergedHitCount += hit ? 1 : 0;
+    convergedMissCount += miss ? 1 : 0;
+    coveredCount++;
+    stepSum += r.stepCount;
+    backStepSum += r.backStep;
+}
+
+void ConvergenceCounts::add(const ConvergenceCounts& c)
+{
+    nonConvergedCount += c.nonConvergedCount;
+    convergedHitCount += c.convergedHitCount;
+    convergedMissCount += c.convergedMissCount;
+    coveredCount += c.coveredCount;
+    stepSum += c.stepSum;
+    backStepSum += c.backStepSum;
+}
+
+void PacketStats::add(const PacketStats& s)
+{
+    rayCount += s.rayCount;
+    laneCount += s.laneCount;
+    iterationCount += s.iterationCount;
+    activeLaneCount += s.activeLaneCount;
+    backStepLaneCount += s.backStepLaneCount;
+    divergentBackStepCount += s.divergentBackStepCount;
+}
+
+void NormalStats::add(float angle)
+{
+    hitCount++;
+    angleSum += angle;
+    angleMax = std::max(angleMax, angle);
+}
+
+void NormalStats::add(const NormalStats& s)
+{
+    hitCount += s.hitCount;
+    angleSum += s.angleSum;
+    angleMax = std::max(angleMax, s.angleMax);
+}
+
+namespace
+{
+enum class PacketISA { None, AVX2, AVX512 };
+
+PacketISA detectPacketISA()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuidex(info, 1, 0);
+    const bool osxsave = info[2] & (1 << 27);
+    const bool fma = info[2] & (1 << 12);
+    if (!osxsave)
+        return PacketISA::None;
+    __cpuidex(info, 7, 0);
+    const bool avx2 = info[1] & (1 << 5);
+    const bool avx512f = info[1] & (1 << 16);
+    const bool avx512dq = info[1] & (1 << 17);
+    const unsigned long long xcr0 = _xgetbv(0);
+    const bool ymmState = (xcr0 & 0x6) == 0x6;
+    const bool zmmState = (xcr0 & 0xe6) == 0xe6;
+    if (avx512f && avx512dq && fma && zmmState)
+        return PacketISA::AVX512;
+    if (avx2 && fma && ymmState)
+        return PacketISA::AVX2;
+    return PacketISA::None;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("fma"))
+        return PacketISA::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return PacketISA::AVX2;
+    return PacketISA::None;
+#else
+    return PacketISA::None;
+#endif
+}
+
+// the kernels report false if they weren't compiled for their instruction set
+PacketISA getPacketISA()
+{
+    static const PacketISA isa = [] {
+        PacketISA detected = detectPacketISA();
+        const packet::KernelDesc desc;
+        packet::KernelRays rays{};
+        packet::KernelResults results;
+        packet::KernelStats stats;
+        if (detected == PacketISA::AVX512 && !packet::traceAutoRelaxationAVX512(desc, rays, 0, results, stats))
+            detected = PacketISA::AVX2;
+        if (detected == PacketISA::AVX2 && !packet::traceAutoRelaxationAVX2(desc, rays, 0, results, stats))
+            detected = PacketISA::None;
+        return detected;
+    }();
+    return isa;
+}
+}
+
+uint getPacketWidth()
+{
+    switch (getPacketISA())
+    {
+    case PacketISA::AVX512:
+        return packet::kWidthAVX512;
+    case PacketISA::AVX2:
+        return packet::kWidthAVX2;
+    default:
+        return 1;
+    }
+}
+
+void traceAutoRelaxationPacket(const SDFTracer& tracer, const Ray* rays, uint count, const SphereTraceDesc& params, TraceResult* results, PacketStats& stats)
+{
+    const PacketISA isa = getPacketISA();
+    if (isa == PacketISA::None) {
+        for (uint i = 0; i < count; ++i)
+            results[i] = tracer.traceAutoRelaxation(rays[i], params);
+        stats.rayCount += count;
+        stats.laneCount += count;
+        return;
+    }
+
+    const Model& model = tracer.getModel();
+    packet::KernelDesc desc;
+    if (const GridSource* grid = dynamic_cast<const GridSource*>(&tracer.getSource())) {
+        const uint3& res = grid->getResolution();
+        desc.gridData = grid->getData();
+        desc.gridResolution[0] = (int)res.x;
+        desc.gridResolution[1] = (int)res.y;
+        desc.gridResolution[2] = (int)res.z;
+    }
+    else {
+        desc.source = &tracer.getSource();
+        desc.sampleFn = [](const void* source, const float* x, const float* y, const float* z, uint64_t activeBits, float* out) {
+            const DistanceSource& src = *static_cast<const DistanceSource*>(source);
+            for (int l = 0; l < packet::kMaxWidth; ++l) {
+                if (activeBits & (1ull << l))
+                    out[l] = src.sample(float3(x[l], y[l], z[l]));
+            }
+        };
+    }
+    desc.oneOverOuterBoxSize[0] = model.oneOverOuterBoxSize.x;
+    desc.oneOverOuterBoxSize[1] = model.oneOverOuterBoxSize.y;
+    desc.oneOverOuterBoxSize[2] = model.oneOverOuterBoxSize.z;
+    desc.epsilon = params.epsilon;
+    desc.stepRelaxation = params.stepRelaxation;
+    desc.maxiters = params.maxiters;
+
+    const uint width = isa == PacketISA::AVX512 ? packet::kWidthAVX512 : packet::kWidthAVX2;
+    packet::KernelStats kernelStats;
+    for (uint first = 0; first < count; first += width) {
+        const uint n = std::min(count - first, width);
+        // trace in local model coordinates
+        packet::KernelRays packetRays{};
+        for (uint l = 0; l < n; ++l) {
+            const Ray& ray = rays[first + l];
+            const float3 o = ray.orig - model.outerBoxCorner;
+            packetRays.ox[l] = o.x; packetRays.oy[l] = o.y; packetRays.oz[l] = o.z;
+            packetRays.dx[l] = ray.dir.x; packetRays.dy[l] = ray.dir.y; packetRays.dz[l] = ray.dir.z;
+            packetRays.tMin[l] = ray.tMin;
+            packetRays.tMax[l] = ray.tMax;
+        }
+        packet::KernelResults packetResults;
+        if (isa == PacketISA::AVX512)
+            packet::traceAutoRelaxationAVX512(desc, packetRays, (int)n, packetResults, kernelStats);
+        else
+            packet::traceAutoRelaxationAVX2(desc, packetRays, (int)n, packetResults, kernelStats);
+
+        for (uint l = 0; l < n; ++l) {
+            TraceResult& ret = results[first + l];
+            const int iters = (int)packetResults.iterations[l];
+            ret.stepCount = (uint)iters;
+            ret.backStep = (uint)packetResults.backSteps[l];
+            ret.T = std::min(packetResults.t[l] + packetResults.r[l], packetRays.tMax[l]);
+            ret.flags = (uint(ret.T >= packetRays.tMax[l]) << 0)           // miss
+                | (uint(packetResults.r[l] <= params.epsilon) << 1)        // hit
+                | (uint(iters >= params.maxiters) << 2);                   // didn't converge
+        }
+        stats.rayCount += n;
+        stats.laneCount += width;
+    }
+    stats.iterationCount += kernelStats.iterationCount;
+    stats.activeLaneCount += kernelStats.activeLaneCount;
+    stats.backStepLaneCount += kernelStats.backStepLaneCount;
+    stats.divergentBackStepCount += kernelStats.divergentBackStepCount;
+}
+
+Frame render(const SDFTracer& tracer, const Camera& camera, const Render_Desc& desc)
+{
+    Frame frame;
+    frame.size = desc.frameSize;
+    frame.pixels.resize((size_t)desc.frameSize.x * desc.frameSize.y);
+    if (desc.frameSize.x == 0 || desc.frameSize.y == 0)
+        return frame;
+
+    const Model& model = tracer.getModel();
+    const float3 boxRadius = 0.5f * model.innerBoxSize;
+    const float3 boxCenter = model.innerBoxCorner + boxRadius;
+    const float3 camForward = normalize(camera.target - camera.position);
+    const float3 camDiff = abs(camera.position - boxCenter) - boxRadius;
+    const bool camInside = camDiff.x < 0.f && camDiff.y < 0.f && camDiff.z < 0.f;
+
+    const uint tileSize = std::max(desc.tileSize, 1u);
+    const uint2 tileCount = (desc.frameSize + tileSize - 1u) / tileSize;
+    const uint tileNum = tileCount.x * tileCount.y;
+    std::atomic<uint> nextTile{ 0 };
+
+    // the rasterized fragment is on the front face of the bounding box,
+    // or on the near plane if the box is clipped (or a full screen quad if the camera is inside)
+    // returns false if the pixel isn't covered by the bounding box
+    auto makeRay = [&](uint x, uint y, Ray& ray) {
+        const float3 dir = camera.getRayDir(float2((float)x + 0.5f, (float)y + 0.5f), desc.frameSize);
+        const float nearT = camera.nearPlane / dot(dir, camForward);
+        float entryT = nearT;
+        if (!camInside) {
+            Ray viewRay;
+            viewRay.orig = camera.position;
+            viewRay.dir = dir;
+            if (!intersectBox(boxCenter, boxRadius, viewRay, true, entryT))
+                return false;
+        }
+        ray = getRay(model, camera.position, camera.position + std::max(entryT, nearT) * dir);
+        return true;
+    };
+
+    // the normal of the hit point (the cost of the shader) and its angle to the central differences
+    auto shadeHit = [&](const Ray& ray, const TraceResult& res, NormalStats& normalStats) {
+        if (desc.normalMode == NormalMode::None || !(res.flags & kTraceHit))
+            return;
+        const float3 pos = ray.orig + ray.dir * res.T;
+        const float3 n = tracer.getNormal(desc.normalMode, pos, desc.normalEps);
+        if (!desc.measureNormalError)
+            return;
+        if (desc.normalMode == NormalMode::CentralDiff) {
+            normalStats.add(0.f);
+            return;
+        }
+        const float3 reference = tracer.getNormalCentralDiff(pos, desc.normalEps);
+        normalStats.add(std::acos(std::clamp(dot(n, reference), -1.f, 1.f)));
+    };
+
+    const bool usePackets = desc.usePackets && desc.traceFunNum == 4;
+    auto worker = [&](ConvergenceCounts& counts, PacketStats& packetStats, NormalStats& normalStats) {
+        // covered rays of the current tile, traced together in packet mode
+        std::vector<Ray> rays;
+        std::vector<size_t> rayPixels;
+        std::vector<TraceResult> rayResults;
+        for (uint tile = nextTile++; tile < tileNum; tile = nextTile++) {
+            const uint2 tileMin = uint2(tile % tileCount.x, tile / tileCount.x) * tileSize;
+            const uint2 tileMax = min(tileMin + tileSize, desc.frameSize);
+            rays.clear();
+            rayPixels.clear();
+            for (uint y = tileMin.y; y < tileMax.y; ++y) {
+                for (uint x = tileMin.x; x < tileMax.x; ++x) {
+                    const size_t pixel = (size_t)y * desc.frameSize.x + x;
+                    Ray ray;
+                    if (!makeRay(x, y, ray)) {
+                        frame.pixels[pixel] = TraceResult{};
+                        continue;
+                    }
+                    if (usePackets) {
+                        rays.push_back(ray);
+                        rayPixels.push_back(pixel);
+                        continue;
+                    }
+                    TraceResult& res = frame.pixels[pixel];
+                    res = tracer.trace(desc.traceFunNum, ray, desc.params);
+                    res.flags |= kTraceCovered;
+                    counts.add(res);
+                    shadeHit(ray, res, normalStats);
+                }
+            }
+            if (rays.empty())
+                continue;
+            rayResults.resize(rays.size());
+            traceAutoRelaxationPacket(tracer, rays.data(), (uint)rays.size(), desc.params, rayResults.data(), packetStats);
+            for (size_t r = 0; r < rays.size(); ++r) {
+                TraceResult& res = frame.pixels[rayPixels[r]];
+                res = rayResults[r];
+                res.flags |= kTraceCovered;
+                counts.add(res);
+                shadeHit(rays[r], res, normalStats);
+            }
+        }
+    };
+
+    const uint threadCount = std::min(desc.threadCount != 0 ? desc.threadCount : std::max(std::thread::hardware_concurrency(), 1u), tileNum);
+    std::vector<ConvergenceCounts> threadCounts(threadCount);
+    std::vector<PacketStats> threadPacketStats(threadCount);
+    std::vector<NormalStats> threadNormalStats(threadCount);
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (uint i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker, std::ref(threadCounts[i]), std::ref(threadPacketStats[i]), std::ref(threadNormalStats[i]));
+    worker(threadCounts[0], threadPacketStats[0], threadNormalStats[0]);
+    for (auto& t : threads)
+        t.join();
+
+    for (const auto& s : threadPacketStats)
+        frame.packetStats.add(s);
+    for (const auto& c : threadCounts)
+        frame.counts.add(c);
+    for (const auto& n : threadNormalStats)
+        frame.normalStats.add(n);
+    return frame;
+}
+
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "Utils/Math/Vector.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Falcor;
+
+class SDFFile;
+
+// CPU reference implementation of the sphere tracers in Shaders/trace.slang.
+// The code mirrors the shaders line by line so its output can be compared with the GPU results.
+// It only uses Falcor's math types, no device is needed.
+namespace cpu_trace
+{
+
+// see Shaders/types.slang
+struct Ray
+{
+    float3 orig;
+    float tMin = 0.f;
+    float3 dir;
+    float tMax = 0.f;
+};
+
+enum TraceFlags : uint
+{
+    kTraceMiss = 1u << 0,        // distance condition:  travelled too far t > t_max
+    kTraceHit = 1u << 1,         // surface condition:   distance to surface is < error threshold
+    kTraceOutOfIters = 1u << 2,  // iteration condition: the trace took too many iterations
+    kTraceCovered = 1u << 8,     // the pixel is covered by the bounding box (the GPU would run the pixel shader)
+};
+
+struct TraceResult
+{
+    float T = 0.f;      // distance taken on ray
+    uint flags = 0;     // TraceFlags
+    uint stepCount = 0; // same as `stepCount` with ENABLE_DEBUG_UTILS
+    uint backStep = 0;  // same as `backStep` with ENABLE_DEBUG_UTILS
+};
+
+struct SphereTraceDesc
+{
+    float epsilon = 0.0001f;     // ray stopping distance to surface
+    int maxiters = 100;          // maximum iteration count
+    float stepRelaxation = 1.6f; // relax sphere trace step
+    bool shadowRay = false;      // whether the trace is for a hard shadow or primary ray
+};
+
+// see MODELcb in Shaders/sdf_model.slang
+struct Model
+{
+    float3 innerBoxCorner{ 0.f };
+    float3 innerBoxSize{ 1.f };
+    float3 outerBoxCorner{ 0.f };
+    float3 outerBoxSize{ 1.f };
+    float3 oneOverOuterBoxSize{ 1.f };
+    uint3 resolution{ 64 };
+
+    // same as SDF::setModelParameters
+    static Model create(float3 boxCorner, float3 boxSize, uint3 resolution);
+};
+
+// getSdfSample in Shaders/sdf.slang
+class DistanceSource
+{
+public:
+    virtual ~DistanceSource() = default;
+    // x: texture coordinates
+    virtual float sample(float3 x) const = 0;
+    // exact gradient of `sample` with respect to x, returns false if the source has none
+    virtual bool gradient(float3 /*x*/, float3& /*grad*/) const { return false; }
+};
+
+// SDF_SOURCE == 1: a grid of samples at texel centers,
+// filtered trilinearly with clamp addressing like `sdfSampler`
+class GridSource : public DistanceSource
+{
+public:
+    GridSource(uint3 resolution, std::vector<float> values);
+
+    float sample(float3 x) const override;
+    // gradient of the trilinear interpolant, see getNormalTrilinear in Shaders/shade.slang
+    bool gradient(float3 x, float3& grad) const override;
+    // i is clamped to the grid
+    float texel(int3 i) const;
+
+    const uint3& getResolution() const { return mResolution; }
+    const float* getData() const { return mValues.data(); }
+
+private:
+    uint3 mResolution;
+    std::vector<float> mValues; // x is the fastest changing coordinate
+};
+
+// the SDF0 samples (mip 0) and the model of a baked SDF file, see SDF::toFile
+// returns nullptr and sets `error` if the file has no SDF0 texture
+std::unique_ptr<GridSource> createGridSource(const SDFFile& file, Model& model, std::string& error);
+
+// SDF_SOURCE == 4: distances and gradients at texel centers,
+// filtered with cubic Hermite interpolation like getHermiteSdfSample in Shaders/hermite.slang
+class HermiteGridSource : public DistanceSource
+{
+public:
+    // values: distance and gradient (world units) per sample, cellSize: outerBoxSize / resolution
+    HermiteGridSource(uint3 resolution, std::vector<float4> values, float3 cellSize);
+
+    float sample(float3 x) const override;
+    // i is clamped to the grid
+    const float4& texel(int3 i) const;
+
+    const uint3& getResolution() const { return mResolution; }
+
+private:
+    uint3 mResolution;
+    std::vector<float4> mValues; // x is the fastest changing coordinate
+    float3 mCellSize;
+};
+
+// the SDF1 samples and the model of a baked SDF file
+// returns nullptr and sets `error` if the file has no SDF1 texture
+std::unique_ptr<HermiteGridSource> createHermiteGridSource(const SDFFile& file, Model& model, std::string& error);
+
+// SDF_SOURCE == 5: 8 bit samples in bricks of 8^3 cells with a min. and scale per brick,
+// decoded like getQuantizedBrickSdfSample in Shaders/quantized_brick.slang
+class QuantizedBrickSource : public DistanceSource
+{
+public:
+    static constexpr uint kBrickSize = 8;   // SDF::kQuantizedBrickSize
+    static constexpr uint kBrickTexels = 9; // SDF::kQuantizedBrickTexels
+
+    // resolution: a multiple of kBrickSize (see SDFFile::open)
+    // atlas: (resolution / kBrickSize * kBrickTexels)^3 samples, ranges: min. and scale per brick
+    QuantizedBrickSource(uint3 resolution, std::vector<uint8_t> atlas, std::vector<float2> ranges);
+
+    float sample(float3 x) const override;
+
+    const uint3& getResolution() const { return mResolution; }
+
+private:
+    float atlasTexel(int3 i) const;
+
+    uint3 mResolution;
+    uint3 mBrickGrid;
+    uint3 mAtlasSize;
+    std::vector<uint8_t> mAtlas; // x is the fastest changing coordinate
+    std::vector<float2> mRanges;
+};
+
+// the quantized bricks and the model of a baked SDF file
+// returns nullptr and sets `error` if the file is not a QuantizedBrick SDF
+std::unique_ptr<QuantizedBrickSource> createQuantizedBrickSource(const SDFFile& file, Model& model, std::string& error);
+
+// createGridSource, createHermiteGridSource or createQuantizedBrickSource depending on the type of the file
+std::unique_ptr<DistanceSource> createFileSource(const SDFFile& file, Model& model, std::string& error);
+
+// SDF_SOURCE == 0: `funDist` evaluated at world coordinates
+class ProceduralSource : public DistanceSource
+{
+public:
+    using Function = std::function<float(float3)>;
+
+    ProceduralSource(Function funDist, float3 outerBoxCorner, float3 outerBoxSize)
+        : mFunDist(std::move(funDist)), mOuterBoxCorner(outerBoxCorner), mOuterBoxSize(outerBoxSize) {}
+
+    float sample(float3 x) const override { return mFunDist(mOuterBoxSize * x + mOuterBoxCorner); }
+
+private:
+    Function mFunDist;
+    float3 mOuterBoxCorner;
+    float3 mOuterBoxSize;
+};
+
+// CPU ports of some of the scenes in Shaders/SDFScenes, looked up by their name in proceduralSDFList.txt
+// returns an empty function if the scene has no port
+ProceduralSource::Function findProceduralFunction(const std::string& name);
+
+// per-brick hints of SDFTracer::traceHinted, see Shaders/step_hint.slang and Shaders/computeStepHint.cs.slang
+class StepHintVolume
+{
+public:
+    static constexpr uint kBrickSize = 8;            // SDF::kStepHintBrickSize
+    static constexpr uint kProceduralGridSize = 32;  // SDF::kProceduralStepHintGridSize
+
+    // the same bake as stepHint_main and stepHintDilate_main, gridSize: bricks over the outer box
+    StepHintVolume(const DistanceSource& source, uint3 gridSize, float3 outerBoxSize, uint threadCount = 0);
+
+    // x: texture coordinates
+    uint3 getBrick(float3 x) const;
+    // xyz: mean of the normalized gradients, w: max. difference quotient of the brick and its neighbors
+    const float4& at(uint3 brick) const { return mHints[brick.x + (size_t)mGridSize.x * (brick.y + (size_t)mGridSize.y * brick.z)]; }
+    // getStepHintSlope
+    static float slope(const float4& hint, float3 dir);
+
+    const uint3& getGridSize() const { return mGridSize; }
+
+private:
+    uint3 mGridSize;
+    std::vector<float4> mHints; // x is the fastest changing coordinate
+};
+
+// getNormal in Shaders/shade.slang
+enum class NormalMode
+{
+    None,           // no shading
+    CentralDiff,    // getNormalCentralDiff
+    ForwardDiff,    // FORWARD_DIFF_NORMAL
+    Analytic,       // ANALYTIC_NORMAL: trilinear gradient of GridSource, tetrahedral differences otherwise
+};
+
+// see SDFTracer in Shaders/trace.slang
+class SDFTracer
+{
+public:
+    SDFTracer(const Model& model, const DistanceSource& source) : mModel(model), mSource(source) {}
+
+    // p: local model coordinates (origin = outerBoxCorner)
+    float sdfInside(float3 p) const { return mSource.sample(p * mModel.oneOverOuterBoxSize); }
+    // p: world coordinates
+    float sdf(float3 p) const { return sdfInside(p - mModel.outerBoxCorner); }
+
+    TraceResult traceClassic(Ray ray, const SphereTraceDesc& params) const;
+    TraceResult traceRelaxed(Ray ray, const SphereTraceDesc& params) const;
+    TraceResult traceEnhanced(Ray ray, const SphereTraceDesc& params) const;
+    TraceResult traceAutoRelaxation(Ray ray, const SphereTraceDesc& params) const;
+    // without step hints it is traceAutoRelaxation
+    TraceResult traceHinted(Ray ray, const SphereTraceDesc& params) const;
+
+    // traceFunNum: same as SDF_TRACE_FUN_NUM, has to be one with a CPU port (see hasTraceFunction)
+    TraceResult trace(int traceFunNum, const Ray& ray, const SphereTraceDesc& params) const;
+    // 1-4 and 7, the hierarchical (5) and segment (6) tracers only run on the GPU
+    static bool hasTraceFunction(int traceFunNum);
+
+    // p: world coordinates, eps: same as shadeNormalEps
+    float3 getNormalCentralDiff(float3 p, float3 eps) const;
+    float3 getNormalForwardDiff(float3 p, float3 eps) const;
+    float3 getNormalTetrahedral(float3 p, float3 eps) const;
+    float3 getNormalAnalytic(float3 p, float3 eps) const;
+    float3 getNormal(NormalMode mode, float3 p, float3 eps) const;
+
+    const Model& getModel() const { return mModel; }
+    const DistanceSource& getSource() const { return mSource; }
+
+    // the hints of traceHinted, not owned
+    void setStepHints(const StepHintVolume* pHints) { mpStepHints = pHints; }
+
+private:
+    Model mModel;
+    const DistanceSource& mSource;
+    const StepHintVolume* mpStepHints = nullptr;
+};
+
+// see Shaders/box_ray_intersecion.slang
+bool intersectBox(float3 boxCenter, float3 boxRadius, Ray ray, bool front, float& dist);
+
+// see getRay in Shaders/cube_main.ps.slang
+// wPos: the world position of the rasterized fragment
+Ray getRay(const Model& model, float3 camPos, float3 wPos);
+
+// pinhole camera with the same conventions as Falcor::Camera
+struct Camera
+{
+    float3 position{ 0.f, 0.f, 1.f };
+    float3 target{ 0.f };
+    float3 up{ 0.f, 1.f, 0.f };
+    float fovY = 0.8f;          // vertical field of view in radians
+    float nearPlane = 0.001f;
+
+    // world space direction through the pixel (pixel centers are at +0.5)
+    float3 getRayDir(float2 pixel, uint2 frameSize) const;
+};
+
+// same counters as DebugUtils, plus step statistics
+struct ConvergenceCounts
+{
+    uint64_t nonConvergedCount = 0;
+    uint64_t convergedHitCount = 0;
+    uint64_t convergedMissCount = 0;
+    uint64_t coveredCount = 0;      // number of traced pixels
+    uint64_t stepSum = 0;
+    uint64_t backStepSum = 0;
+
+    void add(const TraceResult& r);
+    void add(const ConvergenceCounts& c);
+};
+
+// statistics of the ray packet tracer
+struct PacketStats
+{
+    uint64_t rayCount = 0;
+    uint64_t laneCount = 0;              // lanes of the traced packets (including the unused ones)
+    uint64_t iterationCount = 0;         // loop iterations of the packets
+    uint64_t activeLaneCount = 0;        // sum of active lanes over the iterations
+    uint64_t backStepLaneCount = 0;      // sum of backstepping lanes over the iterations
+    uint64_t divergentBackStepCount = 0; // iterations where only some of the active lanes stepped back
+
+    void add(const PacketStats& s);
+};
+
+// error of the shading normals of the hits, measured against getNormalCentralDiff
+struct NormalStats
+{
+    uint64_t hitCount = 0;
+    double angleSum = 0.0;  // radians
+    float angleMax = 0.f;
+
+    void add(float angle);
+    void add(const NormalStats& s);
+};
+
+// Number of lanes used by traceAutoRelaxationPacket: 16 (AVX-512), 8 (AVX2) or 1 (no SIMD support).
+uint getPacketWidth();
+
+// SDFTracer::traceAutoRelaxation for `count` rays, traced in packets of getPacketWidth() rays.
+// GridSource is sampled with gathers, other sources lane by lane.
+void traceAutoRelaxationPacket(const SDFTracer& tracer, const Ray* rays, uint count, const SphereTraceDesc& params, TraceResult* results, PacketStats& stats);
+
+struct Frame
+{
+    uint2 size{ 0 };
+    std::vector<TraceResult> pixels; // row major, top row first
+    ConvergenceCounts counts;
+    PacketStats packetStats;
+    NormalStats normalStats;
+
+    const TraceResult& at(uint x, uint y) const { return pixels[(size_t)y * size.x + x]; }
+};
+
+struct Render_Desc
+{
+    uint2 frameSize{ 1920u, 1080u };
+    int traceFunNum = 1;            // same as SDF_TRACE_FUN_NUM
+    SphereTraceDesc params{};
+    uint tileSize = 16;
+    uint threadCount = 0;           // 0: use all hardware threads
+    bool usePackets = false;        // trace the auto-relaxed tracer (traceFunNum == 4) in ray packets
+    NormalMode normalMode = NormalMode::None; // computes the normal of every hit like the pixel shader
+    float3 normalEps{ 1e-4f };      // same as shadeNormalEps
+    bool measureNormalError = false; // fills Frame::normalStats (the reference normals add to the render time)
+};
+
+// Traces every pixel of the frame, the tiles are distributed between the worker threads.
+Frame render(const SDFTracer& tracer, const Camera& camera, const Render_Desc& desc);
+
+}
@@ -0,0 +1,76 @@
+#include "CpuTracerPacket.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace cpu_trace
+{
+namespace packet
+{
+namespace
+{
+struct AVX2
+{
+    using F = __m256;
+    using I = __m256i;
+    using M = __m256;
+    static constexpr int kWidth = kWidthAVX2;
+
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static F load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, F v) { _mm256_store_ps(p, v); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+    static F floor(F a) { return _mm256_floor_ps(a); }
+    static F blend(M m, F a, F b) { return _mm256_blendv_ps(a, b, m); }
+
+    static M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static M ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static M mand(M a, M b) { return _mm256_and_ps(a, b); }
+    static M mandnot(M a, M b) { return _mm256_andnot_ps(b, a); }
+    static M mor(M a, M b) { return _mm256_or_ps(a, b); }
+    static uint64_t bits(M m) { return (uint64_t)_mm256_movemask_ps(m); }
+
+    static I toInt(F a) { return _mm256_cvttps_epi32(a); }
+    static I iset1(int v) { return _mm256_set1_epi32(v); }
+    static I iadd(I a, I b) { return _mm256_add_epi32(a, b); }
+    static I imul(I a, I b) { return _mm256_mullo_epi32(a, b); }
+    static I iclamp(I a, int lo, int hi) { return _mm256_min_epi32(_mm256_max_epi32(a, _mm256_set1_epi32(lo)), _mm256_set1_epi32(hi)); }
+    static F gather(const float* base, I index) { return _mm256_i32gather_ps(base, index, 4); }
+};
+
+// the kernel is local to this instruction set, see CpuTracerPacket.h
+#include "CpuTracerPacketKernel.h"
+}
+
+bool traceAutoRelaxationAVX2(const KernelDesc& desc, const KernelRays& rays, int count, KernelResults& results, KernelStats& stats)
+{
+    if (count > 0)
+        traceAutoRelaxation<AVX2>(desc, rays, count, results, stats);
+    return true;
+}
+
+}
+}
+
+#else
+
+namespace cpu_trace
+{
+namespace packet
+{
+bool traceAutoRelaxationAVX2(const KernelDesc&, const KernelRays&, int, KernelResults&, KernelStats&)
+{
+    return false;
+}
+}
+}
+
+#endif
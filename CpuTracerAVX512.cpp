@@ -0,0 +1,76 @@
+#include "CpuTracerPacket.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+namespace cpu_trace
+{
+namespace packet
+{
+namespace
+{
+struct AVX512
+{
+    using F = __m512;
+    using I = __m512i;
+    using M = __mmask16;
+    static constexpr int kWidth = kWidthAVX512;
+
+    static F set1(float v) { return _mm512_set1_ps(v); }
+    static F load(const float* p) { return _mm512_load_ps(p); }
+    static void store(float* p, F v) { _mm512_store_ps(p, v); }
+    static F add(F a, F b) { return _mm512_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm512_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm512_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm512_div_ps(a, b); }
+    static F min(F a, F b) { return _mm512_min_ps(a, b); }
+    static F max(F a, F b) { return _mm512_max_ps(a, b); }
+    static F abs(F a) { return _mm512_abs_ps(a); }
+    static F floor(F a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    static F blend(M m, F a, F b) { return _mm512_mask_blend_ps(m, a, b); }
+
+    static M gt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static M ge(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    static M lt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static M le(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    static M mand(M a, M b) { return (M)(a & b); }
+    static M mandnot(M a, M b) { return (M)(a & ~b); }
+    static M mor(M a, M b) { return (M)(a | b); }
+    static uint64_t bits(M m) { return (uint64_t)m; }
+
+    static I toInt(F a) { return _mm512_cvttps_epi32(a); }
+    static I iset1(int v) { return _mm512_set1_epi32(v); }
+    static I iadd(I a, I b) { return _mm512_add_epi32(a, b); }
+    static I imul(I a, I b) { return _mm512_mullo_epi32(a, b); }
+    static I iclamp(I a, int lo, int hi) { return _mm512_min_epi32(_mm512_max_epi32(a, _mm512_set1_epi32(lo)), _mm512_set1_epi32(hi)); }
+    static F gather(const float* base, I index) { return _mm512_i32gather_ps(index, base, 4); }
+};
+
+// the kernel is local to this instruction set, see CpuTracerPacket.h
+#include "CpuTracerPacketKernel.h"
+}
+
+bool traceAutoRelaxationAVX512(const KernelDesc& desc, const KernelRays& rays, int count, KernelResults& results, KernelStats& stats)
+{
+    if (count > 0)
+        traceAutoRelaxation<AVX512>(desc, rays, count, results, stats);
+    return true;
+}
+
+}
+}
+
+#else
+
+namespace cpu_trace
+{
+namespace packet
+{
+bool traceAutoRelaxationAVX512(const KernelDesc&, const KernelRays&, int, KernelResults&, KernelStats&)
+{
+    return false;
+}
+}
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+// Interface of the ray packet kernels of SDFTracer::traceAutoRelaxation, see traceAutoRelaxationPacket in CpuTracer.h.
+// CpuTracerAVX2.cpp and CpuTracerAVX512.cpp are compiled for their own instruction set, so they must not instantiate
+// any inline or template code that the rest of the program uses too (Falcor's vectors, <algorithm>, ...): the linker
+// keeps one copy of those, possibly the AVX one, and CPUs without AVX crash in it even though the kernel selection
+// at runtime is right. Only plain data crosses this interface, and the kernels include nothing but <cstdint>,
+// the intrinsics and CpuTracerPacketKernel.h inside an anonymous namespace.
+namespace cpu_trace
+{
+namespace packet
+{
+
+constexpr int kMaxWidth = 16;
+
+// scalar SDF evaluation of the lanes in `activeBits` at local coordinates in [0, 1]^3, see DistanceSource::sample
+typedef void (*SampleFn)(const void* source, const float* x, const float* y, const float* z, uint64_t activeBits, float* out);
+
+struct KernelDesc
+{
+    // trilinear filtering with clamp addressing (GridSource::sample) if gridData is set, x is the fastest coordinate
+    const float* gridData = nullptr;
+    int gridResolution[3] = { 0, 0, 0 };
+    // every other source
+    SampleFn sampleFn = nullptr;
+    const void* source = nullptr;
+
+    float oneOverOuterBoxSize[3] = { 1.f, 1.f, 1.f };
+    float epsilon = 0.f;
+    float stepRelaxation = 0.f;
+    int maxiters = 0;
+};
+
+// rays in local model coordinates (relative to Model::outerBoxCorner), structure of arrays
+struct KernelRays
+{
+    alignas(64) float ox[kMaxWidth];
+    alignas(64) float oy[kMaxWidth];
+    alignas(64) float oz[kMaxWidth];
+    alignas(64) float dx[kMaxWidth];
+    alignas(64) float dy[kMaxWidth];
+    alignas(64) float dz[kMaxWidth];
+    alignas(64) float tMin[kMaxWidth];
+    alignas(64) float tMax[kMaxWidth];
+};
+
+// state of the rays at the end of the trace: the hit or miss is at t + r
+struct KernelResults
+{
+    alignas(64) float t[kMaxWidth];
+    alignas(64) float r[kMaxWidth];
+    alignas(64) float iterations[kMaxWidth];
+    alignas(64) float backSteps[kMaxWidth];
+};
+
+// see PacketStats
+struct KernelStats
+{
+    uint64_t iterationCount = 0;
+    uint64_t activeLaneCount = 0;
+    uint64_t backStepLaneCount = 0;
+    uint64_t divergentBackStepCount = 0;
+};
+
+// Number of lanes of the kernels.
+constexpr int kWidthAVX2 = 8;
+constexpr int kWidthAVX512 = 16;
+
+// Trace the first `count` rays (at most the width of the kernel).
+// Return false if the translation unit wasn't compiled for the instruction set.
+bool traceAutoRelaxationAVX2(const KernelDesc& desc, const KernelRays& rays, int count, KernelResults& results, KernelStats& stats);
+bool traceAutoRelaxationAVX512(const KernelDesc& desc, const KernelRays& rays, int count, KernelResults& results, KernelStats& stats);
+
+}
+}
@@ -0,0 +1,149 @@
+// Ray packet version of SDFTracer::traceAutoRelaxation.
+// The kernel is written once against a SIMD wrapper (`V`) and included inside an anonymous namespace of
+// CpuTracerAVX2.cpp and CpuTracerAVX512.cpp, so every function here stays local to its instruction set.
+// No includes and no standard library here, see CpuTracerPacket.h.
+
+// `V` has to provide:
+//   types:  F (float lanes), I (int32 lanes), M (lane mask), kWidth
+//   float:  set1, load, store, add, sub, mul, div, min, max, abs, floor, blend(m, a, b) (b where m is set)
+//   mask:   gt, ge, lt, le, mand, mandnot (a & ~b), mor, bits (lane mask as integer)
+//   int:    toInt (truncating), iset1, iadd, imul, iclamp, gather(base, index)
+
+inline uint64_t popcount(uint64_t bits)
+{
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (bits * 0x0101010101010101ull) >> 56;
+}
+
+// trilinear filtering of the grid with clamp addressing, see GridSource::sample
+template<typename V>
+typename V::F sampleGrid(const KernelDesc& desc, typename V::F x, typename V::F y, typename V::F z)
+{
+    using F = typename V::F;
+    using I = typename V::I;
+    const int* res = desc.gridResolution;
+    const F ux = V::sub(V::mul(x, V::set1((float)res[0])), V::set1(0.5f));
+    const F uy = V::sub(V::mul(y, V::set1((float)res[1])), V::set1(0.5f));
+    const F uz = V::sub(V::mul(z, V::set1((float)res[2])), V::set1(0.5f));
+    const F fx0 = V::floor(ux), fy0 = V::floor(uy), fz0 = V::floor(uz);
+    const F fx = V::sub(ux, fx0), fy = V::sub(uy, fy0), fz = V::sub(uz, fz0);
+    // clamp in float first, so the int conversion can't overflow far outside the grid
+    const F lo = V::set1(-1.f);
+    const I ix = V::toInt(V::min(V::max(fx0, lo), V::set1((float)res[0])));
+    const I iy = V::toInt(V::min(V::max(fy0, lo), V::set1((float)res[1])));
+    const I iz = V::toInt(V::min(V::max(fz0, lo), V::set1((float)res[2])));
+    const I x0 = V::iclamp(ix, 0, res[0] - 1), x1 = V::iclamp(V::iadd(ix, V::iset1(1)), 0, res[0] - 1);
+    const I y0 = V::iclamp(iy, 0, res[1] - 1), y1 = V::iclamp(V::iadd(iy, V::iset1(1)), 0, res[1] - 1);
+    const I z0 = V::iclamp(iz, 0, res[2] - 1), z1 = V::iclamp(V::iadd(iz, V::iset1(1)), 0, res[2] - 1);
+    const I strideY = V::iset1(res[0]);
+    const I strideZ = V::iset1(res[0] * res[1]);
+    const I row00 = V::iadd(V::imul(y0, strideY), V::imul(z0, strideZ));
+    const I row10 = V::iadd(V::imul(y1, strideY), V::imul(z0, strideZ));
+    const I row01 = V::iadd(V::imul(y0, strideY), V::imul(z1, strideZ));
+    const I row11 = V::iadd(V::imul(y1, strideY), V::imul(z1, strideZ));
+    const float* data = desc.gridData;
+    auto lerp = [](F a, F b, F t) { return V::add(a, V::mul(t, V::sub(b, a))); };
+    const F c00 = lerp(V::gather(data, V::iadd(row00, x0)), V::gather(data, V::iadd(row00, x1)), fx);
+    const F c10 = lerp(V::gather(data, V::iadd(row10, x0)), V::gather(data, V::iadd(row10, x1)), fx);
+    const F c01 = lerp(V::gather(data, V::iadd(row01, x0)), V::gather(data, V::iadd(row01, x1)), fx);
+    const F c11 = lerp(V::gather(data, V::iadd(row11, x0)), V::gather(data, V::iadd(row11, x1)), fx);
+    return lerp(lerp(c00, c10, fy), lerp(c01, c11, fy), fz);
+}
+
+// any other source is sampled lane by lane outside of the kernel
+template<typename V>
+typename V::F sampleScalar(const KernelDesc& desc, typename V::F x, typename V::F y, typename V::F z, uint64_t activeBits)
+{
+    alignas(64) float xs[V::kWidth], ys[V::kWidth], zs[V::kWidth], out[V::kWidth] = {};
+    V::store(xs, x);
+    V::store(ys, y);
+    V::store(zs, z);
+    desc.sampleFn(desc.source, xs, ys, zs, activeBits, out);
+    return V::load(out);
+}
+
+// traces `count` <= V::kWidth rays
+template<typename V>
+void traceAutoRelaxation(const KernelDesc& desc, const KernelRays& rays, int count, KernelResults& results, KernelStats& stats)
+{
+    using F = typename V::F;
+    using M = typename V::M;
+    constexpr int W = V::kWidth;
+
+    // the unused lanes are empty rays
+    alignas(64) float tMin[W] = {}, tMax[W] = {};
+    for (int l = 0; l < count; ++l) {
+        tMin[l] = rays.tMin[l];
+        tMax[l] = rays.tMax[l];
+    }
+    const F oX = V::load(rays.ox), oY = V::load(rays.oy), oZ = V::load(rays.oz);
+    const F dX = V::load(rays.dx), dY = V::load(rays.dy), dZ = V::load(rays.dz);
+    const F rayTMax = V::load(tMax);
+    const F invX = V::set1(desc.oneOverOuterBoxSize[0]);
+    const F invY = V::set1(desc.oneOverOuterBoxSize[1]);
+    const F invZ = V::set1(desc.oneOverOuterBoxSize[2]);
+    const F eps = V::set1(desc.epsilon);
+    const F relax = V::set1(desc.stepRelaxation);
+    const F maxIters = V::set1((float)desc.maxiters);
+    const F one = V::set1(1.f);
+    const F minusOne = V::set1(-1.f);
+    const uint64_t laneBits = count >= 64 ? ~0ull : ((1ull << count) - 1ull);
+
+    auto sdfInside = [&](F t, uint64_t activeBits) {
+        const F x = V::mul(V::add(oX, V::mul(t, dX)), invX);
+        const F y = V::mul(V::add(oY, V::mul(t, dY)), invY);
+        const F z = V::mul(V::add(oZ, V::mul(t, dZ)), invZ);
+        return desc.gridData ? sampleGrid<V>(desc, x, y, z) : sampleScalar<V>(desc, x, y, z, activeBits);
+    };
+
+    F t = V::load(tMin);
+    F r = sdfInside(t, laneBits);
+    F i = one;
+    F z = r;
+    F m = minusOne;
+    F backSteps = V::set1(0.f);
+
+    auto isActive = [&]() {
+        return V::mand(V::mand(V::lt(V::add(t, r), rayTMax), // miss
+                               V::gt(r, eps)),                // hit
+                       V::lt(i, maxIters));                   // didn't converge
+    };
+    M active = isActive();
+    uint64_t activeBits = V::bits(active) & laneBits;
+    while (activeBits != 0)
+    {
+        const F T = V::add(t, z);
+        const F R = sdfInside(T, activeBits);
+        const M doBackStep = V::gt(z, V::add(V::abs(R), r));
+        const F M_ = V::div(V::sub(R, r), V::max(V::sub(T, t), V::set1(1e-5f)));
+        const F mNext = V::blend(doBackStep, V::add(m, V::mul(relax, V::sub(M_, m))), minusOne);
+        const F tNext = V::blend(doBackStep, T, t);
+        const F rNext = V::blend(doBackStep, R, r);
+        const F omega = V::max(one, V::div(V::set1(2.f), V::sub(one, mNext)));
+        const F zNext = V::max(eps, V::mul(rNext, omega));
+        // only the active lanes are updated
+        m = V::blend(active, m, mNext);
+        t = V::blend(active, t, tNext);
+        r = V::blend(active, r, rNext);
+        z = V::blend(active, z, zNext);
+        i = V::blend(active, i, V::add(i, one));
+        const M activeBack = V::mand(active, doBackStep);
+        backSteps = V::blend(activeBack, backSteps, V::add(backSteps, one));
+
+        const uint64_t backBits = V::bits(activeBack) & laneBits;
+        stats.iterationCount++;
+        stats.activeLaneCount += popcount(activeBits);
+        stats.backStepLaneCount += popcount(backBits);
+        stats.divergentBackStepCount += (backBits != 0 && backBits != activeBits) ? 1 : 0;
+
+        active = V::mand(active, isActive());
+        activeBits = V::bits(active) & laneBits;
+    }
+
+    V::store(results.t, t);
+    V::store(results.r, r);
+    V::store(results.iterations, i);
+    V::store(results.backSteps, backSteps);
+}
@@ -1,4 +1,41 @@
 #include "FlatMesh.h"
+#include "FlatMeshLoader.h"
+#include "Utils/fnv1a.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+// 30 bit Morton code of a point in [0,1]^3
+uint mortonCode3D(float3 p)
+{
+    auto expandBits = [](uint v) {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    };
+    auto quantize = [](float x) { return (uint)std::clamp(x * 1024.f, 0.f, 1023.f); };
+    return (expandBits(quantize(p.x)) << 2) | (expandBits(quantize(p.y)) << 1) | expandBits(quantize(p.z));
+}
+
+struct AABB {
+    float3 lo{ std::numeric_limits<float>::max() };
+    float3 hi{ -std::numeric_limits<float>::max() };
+
+    void grow(float3 p) { lo = min(lo, p); hi = max(hi, p); }
+    void grow(const AABB& b) { lo = min(lo, b.lo); hi = max(hi, b.hi); }
+    float area() const
+    {
+        if (hi.x < lo.x) return 0.f;
+        const float3 d = hi - lo;
+        return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+}
 
 bool FlatMesh::initFromMesh(const ref<Device>& pDevice, const ref<TriangleMesh> pMesh)
 {
@@ -21,10 +58,269 @@ bool FlatMesh::initFromMesh(const ref<Device>& pDevice, const ref<TriangleMesh>
             maxCorner = max(tempBuf.back(), maxCorner);
         }
     }
+    return initFromTriangles(pDevice, std::move(tempBuf), pMesh->getName());
+}
+
+bool FlatMesh::initFromFile(const ref<Device>& pDevice, const std::filesystem::path& path, std::string& error)
+{
+    FlatMeshFileData data;
+    if (!loadFlatMeshFile(path, data, error))
+        return false;
+    minCorner = data.minCorner;
+    maxCorner = data.maxCorner;
+    if (!initFromTriangles(pDevice, std::move(data.triangles), path.filename().string())) {
+        error = "couldn't create the buffers of " + path.filename().string();
+        return false;
+    }
+    return true;
+}
+
+bool FlatMesh::initFromTriangles(const ref<Device>& pDevice, std::vector<float3>&& tempBuf, const std::string& meshName)
+{
     numTriangles = uint(tempBuf.size() / 3);
-    name = pMesh->getName();
+    name = meshName;
+
+    // Morton order of the centroids, so the consecutive triangles of a chunk are close to each other
+    const float3 extent = max(maxCorner - minCorner, float3(1e-20f));
+    std::vector<std::pair<uint, uint>> keys(numTriangles); // (Morton code, triangle)
+    for (uint i = 0; i < numTriangles; ++i) {
+        const float3 centroid = (tempBuf[3 * i] + tempBuf[3 * i + 1] + tempBuf[3 * i + 2]) / 3.f;
+        const float3 rel = (centroid - minCorner) / extent;
+        keys[i] = { mortonCode3D(rel), i };
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<float3> sortedBuf(tempBuf.size());
+    for (uint i = 0; i < numTriangles; ++i) {
+        for (uint j = 0; j < 3; ++j)
+            sortedBuf[3 * i + j] = tempBuf[3 * keys[i].second + j];
+    }
+    tempBuf = std::move(sortedBuf);
+    FNV1a hash;
+    hash.add(tempBuf.data(), tempBuf.size() * sizeof(float3));
+    contentHash = hash.get();
 
     buffer = pDevice->createStructuredBuffer(sizeof(float) * 9, numTriangles, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, MemoryType::DeviceLocal, tempBuf.data(), false);
+    chunkBoxBuffer = nullptr;
+    chunkCount = 0;
+    bvhBuffer = nullptr;
+    bvhDipoleBuffer = nullptr;
+    bvhNodeCount = 0;
+    bvhNodes = nullptr;
+    bvhDipoles = nullptr;
+    triangles = std::make_shared<std::vector<float3>>(std::move(tempBuf));
+
+    return buffer && updateChunkBoxes(pDevice);
+}
+
+bool FlatMesh::updateChunkBoxes(const ref<Device>& pDevice)
+{
+    const std::vector<float3>& tris = *triangles;
+    chunkCount = (numTriangles + kChunkSize - 1) / kChunkSize;
+    std::vector<FlatMeshChunkBox> boxes(chunkCount);
+    for (uint c = 0; c < chunkCount; ++c) {
+        auto& box = boxes[c];
+        box.boxMin = box.boxMax = tris[3 * c * kChunkSize];
+        const uint last = std::min(numTriangles, (c + 1) * kChunkSize);
+        for (uint v = 3 * c * kChunkSize; v < 3 * last; ++v) {
+            box.boxMin = min(box.boxMin, tris[v]);
+            box.boxMax = max(box.boxMax, tris[v]);
+        }
+    }
+    chunkBoxBuffer = pDevice->createStructuredBuffer(sizeof(FlatMeshChunkBox), chunkCount, ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, boxes.data(), false);
+    return !!chunkBoxBuffer;
+}
+
+bool FlatMesh::buildBVH(const ref<Device>& pDevice)
+{
+    if (bvhBuffer) return true;
+    if (!triangles || numTriangles == 0) return false;
+
+    const std::vector<float3>& tris = *triangles;
+    std::vector<AABB> triBoxes(numTriangles);
+    std::vector<float3> centroids(numTriangles);
+    for (uint i = 0; i < numTriangles; ++i) {
+        for (uint j = 0; j < 3; ++j)
+            triBoxes[i].grow(tris[3 * i + j]);
+        centroids[i] = (tris[3 * i] + tris[3 * i + 1] + tris[3 * i + 2]) / 3.f;
+    }
+    std::vector<uint> order(numTriangles);
+    std::iota(order.begin(), order.end(), 0u);
+
+    std::vector<FlatMeshBVHNode> nodes;
+    nodes.reserve(2 * (size_t)numTriangles / kMaxBVHLeafSize + 1);
+    nodes.push_back({});
+
+    struct Task { uint node, first, count, depth; };
+    std::vector<Task> tasks{ { 0, 0, numTriangles, 0 } };
+    constexpr uint kBinCount = 16;
+    while (!tasks.empty()) {
+        const Task task = tasks.back();
+        tasks.pop_back();
+
+        AABB bounds, centroidBounds;
+        for (uint i = task.first; i < task.first + task.count; ++i) {
+            bounds.grow(triBoxes[order[i]]);
+            centroidBounds.grow(centroids[order[i]]);
+        }
+        auto& node = nodes[task.node];
+        node.boxMin = bounds.lo;
+        node.boxMax = bounds.hi;
+        node.leftOrFirst = task.first;
+        node.count = task.count;
+        // the root is at depth 0, the children of a node at depth kMaxBVHDepth - 1 would overflow the traversal stack
+        if (task.count <= kMaxBVHLeafSize || task.depth + 1 >= kMaxBVHDepth) continue;
+
+        // binned SAH along the longest centroid axis
+        const float3 extent = centroidBounds.hi - centroidBounds.lo;
+        const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        uint mid = task.first + task.count / 2;
+        if (extent[axis] > 0.f) {
+            AABB binBoxes[kBinCount];
+            uint binCounts[kBinCount] = {};
+            const float scale = kBinCount / extent[axis];
+            auto binOf = [&](uint tri) {
+                return std::min(kBinCount - 1, (uint)((centroids[tri][axis] - centroidBounds.lo[axis]) * scale));
+            };
+            for (uint i = task.first; i < task.first + task.count; ++i) {
+                const uint b = binOf(order[i]);
+                binCounts[b]++;
+                binBoxes[b].grow(triBoxes[order[i]]);
+            }
+            float rightCost[kBinCount] = {};
+            AABB acc;
+            uint accCount = 0;
+            for (uint b = kBinCount - 1; b > 0; --b) {
+                acc.grow(binBoxes[b]);
+                accCount += binCounts[b];
+                rightCost[b] = acc.area() * accCount;
+            }
+            float bestCost = std::numeric_limits<float>::max();
+            uint bestSplit = 0;
+            acc = AABB();
+            accCount = 0;
+            for (uint b = 0; b + 1 < kBinCount; ++b) {
+                acc.grow(binBoxes[b]);
+                accCount += binCounts[b];
+                const float cost = acc.area() * accCount + rightCost[b + 1];
+                if (accCount != 0 && accCount != task.count && cost < bestCost) {
+                    bestCost = cost;
+                    bestSplit = b;
+                }
+            }
+            if (bestCost < bounds.area() * task.count) {
+                auto it = std::partition(order.begin() + task.first, order.begin() + task.first + task.count,
+                    [&](uint tri) { return binOf(tri) <= bestSplit; });
+                mid = uint(it - order.begin());
+            }
+            else if (task.count <= 4 * kMaxBVHLeafSize) {
+                continue; // splitting doesn't pay off, keep the leaf
+            }
+            else {
+                std::nth_element(order.begin() + task.first, order.begin() + mid, order.begin() + task.first + task.count,
+                    [&](uint a, uint b) { return centroids[a][axis] < centroids[b][axis]; });
+            }
+        }
+        // else: all centroids coincide, split in the middle of the range
+
+        const uint left = (uint)nodes.size();
+        nodes[task.node].leftOrFirst = left;
+        nodes[task.node].count = 0;
+        nodes.push_back({});
+        nodes.push_back({});
+        tasks.push_back({ left, task.first, mid - task.first, task.depth + 1 });
+        tasks.push_back({ left + 1, mid, task.first + task.count - mid, task.depth + 1 });
+    }
+
+    // reorder the triangles to match the leaves
+    auto sorted = std::make_shared<std::vector<float3>>(tris.size());
+    for (uint i = 0; i < numTriangles; ++i) {
+        for (uint j = 0; j < 3; ++j)
+            (*sorted)[3 * i + j] = tris[3 * order[i] + j];
+    }
+    triangles = std::move(sorted);
+
+    // dipoles bottom up, the children are always after their parent in `nodes`
+    std::vector<FlatMeshBVHDipole> dipoles(nodes.size());
+    for (size_t n = nodes.size(); n-- > 0;) {
+        const auto& node = nodes[n];
+        auto& dipole = dipoles[n];
+        float3 weightedCenter{ 0.f };
+        dipole.areaNormal = float3(0.f);
+        dipole.area = 0.f;
+        if (node.count > 0) {
+            for (uint i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+                const float3 a = (*triangles)[3 * i], b = (*triangles)[3 * i + 1], c = (*triangles)[3 * i + 2];
+                const float3 n2 = cross(b - a, c - a);
+                const float area = 0.5f * length(n2);
+                dipole.areaNormal += 0.5f * n2;
+                dipole.area += area;
+                weightedCenter += area * (a + b + c) / 3.f;
+            }
+        }
+        else {
+            for (uint child = node.leftOrFirst; child < node.leftOrFirst + 2; ++child) {
+                dipole.areaNormal += dipoles[child].areaNormal;
+                dipole.area += dipoles[child].area;
+                weightedCenter += dipoles[child].area * dipoles[child].center;
+            }
+        }
+        dipole.center = dipole.area > 0.f ? weightedCenter / dipole.area : 0.5f * (node.boxMin + node.boxMax);
+        // farthest box corner
+        const float3 d = max(abs(node.boxMin - dipole.center), abs(node.boxMax - dipole.center));
+        dipole.radius = length(d);
+    }
+
+    buffer = pDevice->createStructuredBuffer(sizeof(float) * 9, numTriangles, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, MemoryType::DeviceLocal, triangles->data(), false);
+    bvhNodeCount = (uint)nodes.size();
+    bvhBuffer = pDevice->createStructuredBuffer(sizeof(FlatMeshBVHNode), bvhNodeCount, ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, nodes.data(), false);
+    bvhDipoleBuffer = pDevice->createStructuredBuffer(sizeof(FlatMeshBVHDipole), bvhNodeCount, ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, dipoles.data(), false);
+    bvhNodes = std::make_shared<std::vector<FlatMeshBVHNode>>(std::move(nodes));
+    bvhDipoles = std::make_shared<std::vector<FlatMeshBVHDipole>>(std::move(dipoles));
+
+    return buffer && bvhBuffer && bvhDipoleBuffer && updateChunkBoxes(pDevice);
+}
+
+namespace {
+// signed solid angle of the triangle seen from the origin (Van Oosterom and Strackee), positive from behind a CCW triangle
+float triangleSolidAngle(float3 a, float3 b, float3 c)
+{
+    const float la = length(a), lb = length(b), lc = length(c);
+    const float det = dot(a, cross(b, c));
+    const float denom = la * lb * lc + dot(a, b) * lc + dot(b, c) * la + dot(c, a) * lb;
+    return 2.f * std::atan2(det, denom);
+}
+}
+
+float FlatMesh::windingNumber(float3 p, float beta) const
+{
+    if (!bvhNodes || !bvhDipoles || bvhNodes->empty()) return 0.f;
+    const auto& nodes = *bvhNodes;
+    const auto& dipoles = *bvhDipoles;
+    const auto& tris = *triangles;
 
-    return !!buffer;
+    float solidAngle = 0.f;
+    uint stack[kMaxBVHDepth];
+    uint stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const uint n = stack[--stackSize];
+        const auto& dipole = dipoles[n];
+        const float3 d = dipole.center - p;
+        const float dist = length(d);
+        if (dist > beta * dipole.radius) {
+            solidAngle += dot(d, dipole.areaNormal) / (dist * dist * dist);
+            continue;
+        }
+        const auto& node = nodes[n];
+        if (node.count > 0) {
+            for (uint i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+                solidAngle += triangleSolidAngle(tris[3 * i] - p, tris[3 * i + 1] - p, tris[3 * i + 2] - p);
+        }
+        else {
+            stack[stackSize++] = node.leftOrFirst;
+            stack[stackSize++] = node.leftOrFirst + 1;
+        }
+    }
+    constexpr float kFourPi = 12.566370614359172f;
+    return solidAngle / kFourPi;
 }
@@ -5,19 +5,86 @@
 
 using namespace Falcor;
 
+// node of the triangle BVH, same layout as BVHNode in Shaders/mesh.slang
+struct FlatMeshBVHNode {
+    float3 boxMin;
+    uint leftOrFirst; // inner node: index of the left child (the right one is next to it), leaf: first triangle
+    float3 boxMax;
+    uint count;       // number of triangles in a leaf, 0 for inner nodes
+};
+static_assert(sizeof(FlatMeshBVHNode) == 32, "FlatMeshBVHNode has to match BVHNode in mesh.slang");
+
+// bounds of kChunkSize consecutive triangles, same layout as MeshChunkBox in Shaders/mesh.slang
+struct FlatMeshChunkBox {
+    float3 boxMin;
+    float _pad0;
+    float3 boxMax;
+    float _pad1;
+};
+static_assert(sizeof(FlatMeshChunkBox) == 32, "FlatMeshChunkBox has to match MeshChunkBox in mesh.slang");
+
+// far field approximation of the triangles of a BVH node for the winding number, same layout as BVHDipole in Shaders/mesh.slang
+struct FlatMeshBVHDipole {
+    float3 center;     // area weighted centroid of the triangles
+    float radius;      // the node box is inside the ball of this radius around the center
+    float3 areaNormal; // sum of the area weighted triangle normals
+    float area;
+};
+static_assert(sizeof(FlatMeshBVHDipole) == 32, "FlatMeshBVHDipole has to match BVHDipole in mesh.slang");
 
 // Stores a mesh as a list of triangles, no indexbuffer.
 // Only contains positions, no other attributes.
 class FlatMesh {
 public:
+    // keep in sync with MESH_BVH_MAX_DEPTH in mesh.slang (traversal stack size)
+    static constexpr uint kMaxBVHDepth = 64;
+    static constexpr uint kMaxBVHLeafSize = 4;
+    // triangles per chunk of the brute force generation, keep in sync with MESH_CHUNK_SIZE in mesh.slang
+    static constexpr uint kChunkSize = 8192;
+    // a node is approximated by its dipole if the query point is farther than kWindingNumberBeta * radius,
+    // keep in sync with MESH_WINDING_BETA in mesh.slang
+    static constexpr float kWindingNumberBeta = 2.f;
+
+    // The triangles are sorted along a Morton curve, so the chunks of `chunkBoxBuffer` are spatially tight.
     bool initFromMesh(const ref<Device>& pDevice, const ref<TriangleMesh> pMesh);
+    // Loads an OBJ, STL or PLY file directly, without creating a TriangleMesh, see loadFlatMeshFile.
+    // returns false and sets `error` on failure
+    bool initFromFile(const ref<Device>& pDevice, const std::filesystem::path& path, std::string& error);
     void reset() { *this = FlatMesh(); }
 
+    // Builds a BVH over the triangles with binned SAH and uploads it to `bvhBuffer`.
+    // The triangles in `buffer` are reordered so the leaves reference continuous ranges.
+    // The dipoles of the nodes are uploaded to `bvhDipoleBuffer`.
+    // Does nothing if the BVH is already built.
+    bool buildBVH(const ref<Device>& pDevice);
+
+    // Generalized winding number at `p`, ~1 inside and ~0 outside, also for meshes with holes.
+    // Barnes-Hut style: the BVH nodes far from `p` are approximated by their dipoles, the rest is summed exactly.
+    // Requires the BVH, see windingNumberBVH in mesh.slang for the GPU version.
+    float windingNumber(float3 p, float beta = kWindingNumberBeta) const;
+
     std::string name;
     uint numTriangles = 0;
+    uint64_t contentHash = 0; // FNV-1a of the triangles in their initial (Morton) order, see SDFCache::computeKey
 
     float3 minCorner{ 0 };
     float3 maxCorner{ 0 };
 
     ref<Buffer> buffer;
+    ref<Buffer> chunkBoxBuffer; // FlatMeshChunkBox for every kChunkSize triangles of `buffer`
+    uint chunkCount = 0;
+    ref<Buffer> bvhBuffer;
+    ref<Buffer> bvhDipoleBuffer;
+    uint bvhNodeCount = 0;
+    // CPU copy of `buffer`, 3 vertices per triangle (shared between the copies of the mesh)
+    std::shared_ptr<std::vector<float3>> triangles;
+    // CPU copies of `bvhBuffer` and `bvhDipoleBuffer`
+    std::shared_ptr<std::vector<FlatMeshBVHNode>> bvhNodes;
+    std::shared_ptr<std::vector<FlatMeshBVHDipole>> bvhDipoles;
+
+private:
+    // takes the triangle soup, `minCorner` and `maxCorner` have to be set
+    bool initFromTriangles(const ref<Device>& pDevice, std::vector<float3>&& tempBuf, const std::string& meshName);
+    // uploads the boxes of the chunks of `triangles`
+    bool updateChunkBoxes(const ref<Device>& pDevice);
 };
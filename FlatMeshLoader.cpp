@@ -0,0 +1,717 @@
+#include "FlatMeshLoader.h"
+
+#include "Core/Platform/MemoryMappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace {
+struct Bounds {
+    float3 lo{ std::numeric_limits<float>::max() };
+    float3 hi{ -std::numeric_limits<float>::max() };
+
+    void grow(float3 p) { lo = min(lo, p); hi = max(hi, p); }
+    void grow(const Bounds& b) { lo = min(lo, b.lo); hi = max(hi, b.hi); }
+};
+
+// calls f(chunk) for every chunk in [0, chunkCount) on at most threadCount threads
+template<typename F>
+void parallelFor(uint32_t chunkCount, uint32_t threadCount, const F& f)
+{
+    threadCount = std::min(threadCount, chunkCount);
+    std::atomic<uint32_t> next{ 0 };
+    auto worker = [&] {
+        for (uint32_t chunk = next++; chunk < chunkCount; chunk = next++)
+            f(chunk);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (uint32_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+}
+
+// [first, last) of the items of a chunk when `count` items are split into `chunkCount` chunks
+std::pair<uint64_t, uint64_t> chunkRange(uint64_t count, uint32_t chunkCount, uint32_t chunk)
+{
+    return { count * chunk / chunkCount, count * (chunk + 1) / chunkCount };
+}
+
+void finishBounds(const std::vector<Bounds>& chunkBounds, FlatMeshFileData& data)
+{
+    Bounds bounds;
+    for (const auto& b : chunkBounds)
+        bounds.grow(b);
+    data.minCorner = bounds.lo;
+    data.maxCorner = bounds.hi;
+}
+
+// ---- text parsing ----
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+const char* skipToken(const char* p, const char* end)
+{
+    while (p < end && !isSpace(*p) && *p != '\n') ++p;
+    return p;
+}
+// start of the next line
+const char* skipLine(const char* p, const char* end)
+{
+    const void* newLine = std::memchr(p, '\n', end - p);
+    return newLine ? static_cast<const char*>(newLine) + 1 : end;
+}
+bool startsWith(const char* p, const char* end, const char* word)
+{
+    const size_t n = std::strlen(word);
+    return size_t(end - p) > n && std::memcmp(p, word, n) == 0 && isSpace(p[n]);
+}
+
+bool parseFloat(const char*& p, const char* end, float& value)
+{
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') ++p;
+    const auto result = std::from_chars(p, end, value);
+    p = result.ptr;
+    return result.ec == std::errc();
+}
+bool parseInt(const char*& p, const char* end, int64_t& value)
+{
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') ++p;
+    const auto result = std::from_chars(p, end, value);
+    p = result.ptr;
+    return result.ec == std::errc();
+}
+bool parseFloat3(const char*& p, const char* end, float3& v)
+{
+    return parseFloat(p, end, v.x) && parseFloat(p, end, v.y) && parseFloat(p, end, v.z);
+}
+
+// `chunkCount` + 1 boundaries of the text, every chunk starts at the start of a line
+std::vector<const char*> splitLines(const char* begin, const char* end, uint32_t chunkCount)
+{
+    std::vector<const char*> bounds(chunkCount + 1, end);
+    bounds[0] = begin;
+    for (uint32_t i = 1; i < chunkCount; ++i) {
+        const char* p = std::max(begin + (end - begin) * i / chunkCount, bounds[i - 1]);
+        bounds[i] = p == begin ? begin : skipLine(p - 1, end);
+    }
+    return bounds;
+}
+
+// ---- OBJ ----
+
+// negative (relative) indices are resolved after the vertex offsets of the chunks are known
+constexpr int64_t kRelativeIndex = int64_t(1) << 40;
+
+struct ObjChunk {
+    std::vector<float3> vertices;
+    std::vector<int64_t> indices; // 3 per triangle, 0 based, relative to the chunk if negative (+ kRelativeIndex)
+    bool ok = true;
+};
+
+void parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    std::vector<int64_t> face;
+    for (; p < end; p = skipLine(p, end)) {
+        p = skipSpaces(p, end);
+        if (startsWith(p, end, "v")) {
+            p += 1;
+            float3 v;
+            if (!parseFloat3(p, end, v)) {
+                chunk.ok = false;
+                return;
+            }
+            chunk.vertices.push_back(v);
+        }
+        else if (startsWith(p, end, "f")) {
+            p += 1;
+            face.clear();
+            while (true) {
+                p = skipSpaces(p, end);
+                if (p >= end || *p == '\n' || *p == '#') break;
+                int64_t index = 0;
+                if (!parseInt(p, end, index) || index == 0) {
+                    chunk.ok = false;
+                    return;
+                }
+                face.push_back(index > 0 ? index - 1 : (int64_t)chunk.vertices.size() + index - kRelativeIndex);
+                p = skipToken(p, end); // "/vt/vn"
+            }
+            for (size_t k = 1; k + 1 < face.size(); ++k) {
+                chunk.indices.push_back(face[0]);
+                chunk.indices.push_back(face[k]);
+                chunk.indices.push_back(face[k + 1]);
+            }
+        }
+    }
+}
+
+bool loadObj(const char* begin, const char* end, FlatMeshFileData& data, std::string& error, uint32_t threadCount)
+{
+    // 1. vertices and face indices per chunk
+    const uint32_t chunkCount = threadCount;
+    const auto lines = splitLines(begin, end, chunkCount);
+    std::vector<ObjChunk> chunks(chunkCount);
+    parallelFor(chunkCount, threadCount, [&](uint32_t c) { parseObjChunk(lines[c], lines[c + 1], chunks[c]); });
+
+    std::vector<uint64_t> vertexOffsets(chunkCount + 1, 0), indexOffsets(chunkCount + 1, 0);
+    for (uint32_t c = 0; c < chunkCount; ++c) {
+        if (!chunks[c].ok) {
+            error = "syntax error in a vertex or face line";
+            return false;
+        }
+        vertexOffsets[c + 1] = vertexOffsets[c] + chunks[c].vertices.size();
+        indexOffsets[c + 1] = indexOffsets[c] + chunks[c].indices.size();
+    }
+    const uint64_t vertexCount = vertexOffsets[chunkCount];
+    std::vector<float3> vertices(vertexCount);
+    parallelFor(chunkCount, threadCount, [&](uint32_t c) {
+        std::copy(chunks[c].vertices.begin(), chunks[c].vertices.end(), vertices.begin() + vertexOffsets[c]);
+        chunks[c].vertices = {};
+    });
+
+    // 2. the triangles, each chunk writes its own range
+    data.triangles.resize(indexOffsets[chunkCount]);
+    std::vector<Bounds> bounds(chunkCount);
+    std::atomic<bool> validIndices{ true };
+    parallelFor(chunkCount, threadCount, [&](uint32_t c) {
+        float3* out = data.triangles.data() + indexOffsets[c];
+        for (int64_t index : chunks[c].indices) {
+            const int64_t global = index < 0 ? (int64_t)vertexOffsets[c] + index + kRelativeIndex : index;
+            if (global < 0 || (uint64_t)global >= vertexCount) {
+                validIndices = false;
+                return;
+            }
+            *out++ = vertices[global];
+            bounds[c].grow(vertices[global]);
+        }
+    });
+    if (!validIndices) {
+        error = "a face references a missing vertex";
+        return false;
+    }
+    finishBounds(bounds, data);
+    return true;
+}
+
+// ---- STL ----
+
+bool loadStlBinary(const uint8_t* begin, uint64_t triangleCount, FlatMeshFileData& data, uint32_t threadCount)
+{
+    constexpr size_t kHeaderSize = 84, kTriangleSize = 50, kNormalSize = 12;
+    data.triangles.resize(3 * triangleCount);
+    std::vector<Bounds> bounds(threadCount);
+    parallelFor(threadCount, threadCount, [&](uint32_t c) {
+        const auto [first, last] = chunkRange(triangleCount, threadCount, c);
+        for (uint64_t t = first; t < last; ++t) {
+            const uint8_t* src = begin + kHeaderSize + t * kTriangleSize + kNormalSize;
+            for (uint64_t k = 0; k < 3; ++k) {
+                float3& v = data.triangles[3 * t + k];
+                std::memcpy(&v, src + k * sizeof(float3), sizeof(float3));
+                bounds[c].grow(v);
+            }
+        }
+    });
+    finishBounds(bounds, data);
+    return true;
+}
+
+bool loadStlAscii(const char* begin, const char* end, FlatMeshFileData& data, std::string& error, uint32_t threadCount)
+{
+    const uint32_t chunkCount = threadCount;
+    const auto lines = splitLines(begin, end, chunkCount);
+    std::vector<std::vector<float3>> vertices(chunkCount);
+    std::vector<Bounds> bounds(chunkCount);
+    std::atomic<bool> ok{ true };
+    parallelFor(chunkCount, threadCount, [&](uint32_t c) {
+        for (const char* p = lines[c]; p < lines[c + 1]; p = skipLine(p, lines[c + 1])) {
+            p = skipSpaces(p, lines[c + 1]);
+            if (!startsWith(p, lines[c + 1], "vertex")) continue;
+            p += 6;
+            float3 v;
+            if (!parseFloat3(p, lines[c + 1], v)) {
+                ok = false;
+                return;
+            }
+            vertices[c].push_back(v);
+            bounds[c].grow(v);
+        }
+    });
+    std::vector<uint64_t> offsets(chunkCount + 1, 0);
+    for (uint32_t c = 0; c < chunkCount; ++c)
+        offsets[c + 1] = offsets[c] + vertices[c].size();
+    if (!ok || offsets[chunkCount] % 3 != 0) {
+        error = "syntax error in a facet";
+        return false;
+    }
+    data.triangles.resize(offsets[chunkCount]);
+    parallelFor(chunkCount, threadCount, [&](uint32_t c) {
+        std::copy(vertices[c].begin(), vertices[c].end(), data.triangles.begin() + offsets[c]);
+    });
+    finishBounds(bounds, data);
+    return true;
+}
+
+bool loadStl(const uint8_t* begin, size_t size, FlatMeshFileData& data, std::string& error, uint32_t threadCount)
+{
+    // binary files can start with "solid" too, the size decides
+    if (size >= 84) {
+        uint32_t triangleCount = 0;
+        std::memcpy(&triangleCount, begin + 80, sizeof(triangleCount));
+        if (84 + 50 * (uint64_t)triangleCount == size)
+            return loadStlBinary(begin, triangleCount, data, threadCount);
+    }
+    const char* text = reinterpret_cast<const char*>(begin);
+    if (!startsWith(skipSpaces(text, text + size), text + size, "solid")) {
+        error = "neither a binary nor an ASCII STL file";
+        return false;
+    }
+    return loadStlAscii(text, text + size, data, error, threadCount);
+}
+
+// ---- PLY ----
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+PlyType parsePlyType(const std::string& name)
+{
+    if (name == "char" || name == "int8") return PlyType::Int8;
+    if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+    if (name == "short" || name == "int16") return PlyType::Int16;
+    if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+    if (name == "int" || name == "int32") return PlyType::Int32;
+    if (name == "uint" || name == "uint32") return PlyType::UInt32;
+    if (name == "float" || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+size_t getPlyTypeSize(PlyType type)
+{
+    constexpr size_t kSizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+    return kSizes[(int)type];
+}
+
+template<typename T>
+T readPlyRaw(const uint8_t* p, bool swapBytes)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swapBytes)
+        std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+double readPlyValue(const uint8_t* p, PlyType type, bool swapBytes)
+{
+    switch (type) {
+    case PlyType::Int8: return (double)readPlyRaw<int8_t>(p, swapBytes);
+    case PlyType::UInt8: return (double)readPlyRaw<uint8_t>(p, swapBytes);
+    case PlyType::Int16: return (double)readPlyRaw<int16_t>(p, swapBytes);
+    case PlyType::UInt16: return (double)readPlyRaw<uint16_t>(p, swapBytes);
+    case PlyType::Int32: return (double)readPlyRaw<int32_t>(p, swapBytes);
+    case PlyType::UInt32: return (double)readPlyRaw<uint32_t>(p, swapBytes);
+    case PlyType::Float32: return (double)readPlyRaw<float>(p, swapBytes);
+    case PlyType::Float64: return readPlyRaw<double>(p, swapBytes);
+    default: return 0.0;
+    }
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyType::Invalid;      // type of the value or of the list items
+    PlyType countType = PlyType::Invalid; // type of the item count of lists, Invalid for scalars
+};
+struct PlyElement {
+    std::string name;
+    uint64_t count = 0;
+    std::vector<PlyProperty> properties;
+
+    bool hasLists() const
+    {
+        return std::any_of(properties.begin(), properties.end(), [](const PlyProperty& p) { return p.countType != PlyType::Invalid; });
+    }
+    // size of an item without lists
+    size_t stride() const
+    {
+        size_t size = 0;
+        for (const auto& p : properties) size += getPlyTypeSize(p.type);
+        return size;
+    }
+    int find(const char* propertyName) const
+    {
+        for (size_t i = 0; i < properties.size(); ++i)
+            if (properties[i].name == propertyName) return (int)i;
+        return -1;
+    }
+};
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+struct PlyHeader {
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    size_t size = 0; // bytes up to the body
+};
+
+bool parsePlyHeader(const char* begin, const char* end, PlyHeader& header, std::string& error)
+{
+    const char* p = begin;
+    if (end - p < 4 || std::memcmp(p, "ply", 3) != 0 || (p[3] != '\n' && p[3] != '\r')) {
+        error = "not a PLY file";
+        return false;
+    }
+    auto nextWord = [&](const char*& q, const char* lineEnd) {
+        q = skipSpaces(q, lineEnd);
+        const char* wordEnd = skipToken(q, lineEnd);
+        std::string word(q, wordEnd);
+        q = wordEnd;
+        return word;
+    };
+    for (p = skipLine(p, end); p < end; p = skipLine(p, end)) {
+        const char* lineEnd = skipLine(p, end);
+        const char* q = p;
+        const std::string keyword = nextWord(q, lineEnd);
+        if (keyword == "end_header") {
+            header.size = lineEnd - begin;
+            return true;
+        }
+        if (keyword == "format") {
+            const std::string format = nextWord(q, lineEnd);
+            if (format == "ascii") header.format = PlyFormat::Ascii;
+            else if (format == "binary_little_endian") header.format = PlyFormat::BinaryLittleEndian;
+            else if (format == "binary_big_endian") header.format = PlyFormat::BinaryBigEndian;
+            else {
+                error = "unknown PLY format " + format;
+                return false;
+            }
+        }
+        else if (keyword == "element") {
+            PlyElement element;
+            element.name = nextWord(q, lineEnd);
+            int64_t count = 0;
+            if (!parseInt(q, lineEnd, count) || count < 0) {
+                error = "invalid element count of " + element.name;
+                return false;
+            }
+            element.count = (uint64_t)count;
+            header.elements.push_back(element);
+        }
+        else if (keyword == "property") {
+            if (header.elements.empty()) {
+                error = "property without element";
+                return false;
+            }
+            PlyProperty property;
+            std::string type = nextWord(q, lineEnd);
+            if (type == "list") {
+                property.countType = parsePlyType(nextWord(q, lineEnd));
+                type = nextWord(q, lineEnd);
+                if (property.countType == PlyType::Invalid) {
+                    error = "invalid list count type";
+                    return false;
+                }
+            }
+            property.type = parsePlyType(type);
+            property.name = nextWord(q, lineEnd);
+            if (property.type == PlyType::Invalid) {
+                error = "invalid property type " + type;
+                return false;
+            }
+            header.elements.back().properties.push_back(property);
+        }
+        // comment, obj_info: ignored
+    }
+    error = "missing end_header";
+    return false;
+}
+
+// binary: advances p over an item of the element, false if the file is truncated
+bool skipPlyItem(const PlyElement& element, const uint8_t*& p, const uint8_t* end, bool swapBytes)
+{
+    for (const auto& property : element.properties) {
+        size_t size = getPlyTypeSize(property.type);
+        if (property.countType != PlyType::Invalid) {
+            const size_t countSize = getPlyTypeSize(property.countType);
+            if (size_t(end - p) < countSize) return false;
+            const double count = readPlyValue(p, property.countType, swapBytes);
+            p += countSize;
+            size *= (size_t)std::max(count, 0.0);
+        }
+        if (size_t(end - p) < size) return false;
+        p += size;
+    }
+    return true;
+}
+
+bool loadPlyBinary(const uint8_t* body, const uint8_t* end, const PlyHeader& header, FlatMeshFileData& data, std::string& error, uint32_t threadCount)
+{
+    const bool swapBytes = header.format == PlyFormat::BinaryBigEndian;
+    const PlyElement* vertexElement = nullptr;
+    const PlyElement* faceElement = nullptr;
+    const uint8_t* vertexData = nullptr;
+    const uint8_t* faceData = nullptr;
+
+    // locate the elements, the ones without lists are skipped at once
+    const uint8_t* p = body;
+    for (const auto& element : header.elements) {
+        if (element.name == "vertex") { vertexElement = &element; vertexData = p; }
+        if (element.name == "face") { faceElement = &element; faceData = p; }
+        if (element.name == "face" && element.count > 0) break; // the face data is walked below
+        if (!element.hasLists()) {
+            const uint64_t size = element.count * element.stride();
+            if (uint64_t(end - p) < size) {
+                error = "truncated element " + element.name;
+                return false;
+            }
+            p += size;
+        }
+        else {
+            for (uint64_t i = 0; i < element.count; ++i) {
+                if (!skipPlyItem(element, p, end, swapBytes)) {
+                    error = "truncated element " + element.name;
+                    return false;
+                }
+            }
+        }
+    }
+    if (!vertexElement || !faceElement || vertexData > faceData) {
+        error = "a vertex element followed by a face element is required";
+        return false;
+    }
+    const int xyz[3] = { vertexElement->find("x"), vertexElement->find("y"), vertexElement->find("z") };
+    if (vertexElement->hasLists() || xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0) {
+        error = "the vertices need x, y, z and no lists";
+        return false;
+    }
+    size_t xyzOffsets[3] = {};
+    for (int axis = 0; axis < 3; ++axis)
+        for (int i = 0; i < xyz[axis]; ++i)
+            xyzOffsets[axis] += getPlyTypeSize(vertexElement->properties[i].type);
+
+    // vertices
+    const uint64_t vertexCount = vertexElement->count;
+    const size_t vertexStride = vertexElement->stride();
+    std::vector<float3> vertices(vertexCount);
+    parallelFor(threadCount, threadCount, [&](uint32_t c) {
+        const auto [first, last] = chunkRange(vertexCount, threadCount, c);
+        for (uint64_t v = first; v < last; ++v) {
+            const uint8_t* src = vertexData + v * vertexStride;
+            for (int axis = 0; axis < 3; ++axis)
+                vertices[v][axis] = (float)readPlyValue(src + xyzOffsets[axis], vertexElement->properties[xyz[axis]].type, swapBytes);
+        }
+    });
+
+    // faces: a sequential pass finds the start of the chunks and their triangle counts (the lists have variable size)
+    const int indexProperty = std::max(faceElement->find("vertex_indices"), faceElement->find("vertex_index"));
+    if (indexProperty < 0 || faceElement->properties[indexProperty].countType == PlyType::Invalid) {
+        error = "the faces need a vertex_indices list";
+        return false;
+    }
+    const uint64_t faceCount = faceElement->count;
+    std::vector<const uint8_t*> chunkStarts(threadCount);
+    std::vector<uint64_t> triangleOffsets(threadCount + 1, 0);
+    p = faceData;
+    for (uint32_t c = 0; c < threadCount; ++c) {
+        const auto [first, last] = chunkRange(faceCount, threadCount, c);
+        chunkStarts[c] = p;
+        uint64_t triangles = 0;
+        for (uint64_t f = first; f < last; ++f) {
+            const uint8_t* item = p;
+            if (!skipPlyItem(*faceElement, p, end, swapBytes)) {
+                error = "truncated face element";
+                return false;
+            }
+            // the count of the index list
+            for (int i = 0; i < indexProperty; ++i)
+                item += getPlyTypeSize(faceElement->properties[i].type);
+            const double n = readPlyValue(item, faceElement->properties[indexProperty].countType, swapBytes);
+            triangles += n >= 3 ? (uint64_t)n - 2 : 0;
+        }
+        triangleOffsets[c + 1] = triangleOffsets[c] + triangles;
+    }
+
+    data.triangles.resize(3 * triangleOffsets[threadCount]);
+    std::vector<Bounds> bounds(threadCount);
+    std::atomic<bool> validIndices{ true };
+    const auto& indexList = faceElement->properties[indexProperty];
+    const size_t indexSize = getPlyTypeSize(indexList.type);
+    parallelFor(threadCount, threadCount, [&](uint32_t c) {
+        const auto [first, last] = chunkRange(faceCount, threadCount, c);
+        const uint8_t* q = chunkStarts[c];
+        float3* out = data.triangles.data() + 3 * triangleOffsets[c];
+        for (uint64_t f = first; f < last; ++f) {
+            const uint8_t* item = q;
+            skipPlyItem(*faceElement, q, end, swapBytes); // checked above
+            for (int i = 0; i < indexProperty; ++i)
+                item += getPlyTypeSize(faceElement->properties[i].type);
+            const uint64_t n = (uint64_t)std::max(readPlyValue(item, indexList.countType, swapBytes), 0.0);
+            item += getPlyTypeSize(indexList.countType);
+            auto vertex = [&](uint64_t k) -> const float3* {
+                const double index = readPlyValue(item + k * indexSize, indexList.type, swapBytes);
+                return index >= 0 && index < (double)vertexCount ? &vertices[(uint64_t)index] : nullptr;
+            };
+            for (uint64_t k = 1; k + 1 < n; ++k) {
+                const float3* v[3] = { vertex(0), vertex(k), vertex(k + 1) };
+                if (!v[0] || !v[1] || !v[2]) {
+                    validIndices = false;
+                    return;
+                }
+                for (const float3* pv : v) {
+                    *out++ = *pv;
+                    bounds[c].grow(*pv);
+                }
+            }
+        }
+    });
+    if (!validIndices) {
+        error = "a face references a missing vertex";
+        return false;
+    }
+    finishBounds(bounds, data);
+    return true;
+}
+
+// ASCII PLY is parsed sequentially, large scans are stored in binary
+bool loadPlyAscii(const char* p, const char* end, const PlyHeader& header, FlatMeshFileData& data, std::string& error)
+{
+    std::vector<float3> vertices;
+    std::vector<uint64_t> indices;
+    std::vector<double> values;
+    for (const auto& element : header.elements) {
+        const bool isVertex = element.name == "vertex";
+        const bool isFace = element.name == "face";
+        const int xyz[3] = { element.find("x"), element.find("y"), element.find("z") };
+        const int indexProperty = std::max(element.find("vertex_indices"), element.find("vertex_index"));
+        if (isVertex && (xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0)) {
+            error = "the vertices need x, y, z";
+            return false;
+        }
+        for (uint64_t i = 0; i < element.count; ++i, p = skipLine(p, end)) {
+            if (p >= end) {
+                error = "truncated element " + element.name;
+                return false;
+            }
+            if (!isVertex && !isFace) continue;
+            float3 v;
+            for (int prop = 0; prop < (int)element.properties.size(); ++prop) {
+                const auto& property = element.properties[prop];
+                int64_t n = 1;
+                if (property.countType != PlyType::Invalid && !parseInt(p, end, n)) {
+                    error = "syntax error in element " + element.name;
+                    return false;
+                }
+                values.clear();
+                for (int64_t k = 0; k < n; ++k) {
+                    float value;
+                    if (!parseFloat(p, end, value)) {
+                        error = "syntax error in element " + element.name;
+                        return false;
+                    }
+                    values.push_back(value);
+                }
+                if (isVertex) {
+                    for (int axis = 0; axis < 3; ++axis)
+                        if (prop == xyz[axis]) v[axis] = (float)values[0];
+                }
+                else if (prop == indexProperty) {
+                    for (size_t k = 1; k + 1 < values.size(); ++k) {
+                        indices.push_back((uint64_t)values[0]);
+                        indices.push_back((uint64_t)values[k]);
+                        indices.push_back((uint64_t)values[k + 1]);
+                    }
+                }
+            }
+            if (isVertex) vertices.push_back(v);
+        }
+    }
+
+    Bounds bounds;
+    data.triangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (indices[i] >= vertices.size()) {
+            error = "a face references a missing vertex";
+            return false;
+        }
+        data.triangles[i] = vertices[indices[i]];
+        bounds.grow(data.triangles[i]);
+    }
+    finishBounds({ bounds }, data);
+    return true;
+}
+
+bool loadPly(const uint8_t* begin, size_t size, FlatMeshFileData& data, std::string& error, uint32_t threadCount)
+{
+    const char* text = reinterpret_cast<const char*>(begin);
+    PlyHeader header;
+    if (!parsePlyHeader(text, text + size, header, error))
+        return false;
+    if (header.format == PlyFormat::Ascii)
+        return loadPlyAscii(text + header.size, text + size, header, data, error);
+    return loadPlyBinary(begin + header.size, begin + size, header, data, error, threadCount);
+}
+
+std::string getLowerExtension(const std::filesystem::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return ext;
+}
+}
+
+bool isFlatMeshFileSupported(const std::filesystem::path& path)
+{
+    const std::string ext = getLowerExtension(path);
+    return ext == ".obj" || ext == ".stl" || ext == ".ply";
+}
+
+bool loadFlatMeshFile(const std::filesystem::path& path, FlatMeshFileData& data, std::string& error, uint32_t threadCount)
+{
+    data = FlatMeshFileData();
+    if (!isFlatMeshFileSupported(path)) {
+        error = "unsupported mesh file " + path.string();
+        return false;
+    }
+    MemoryMappedFile file(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+    if (!file.isOpen()) {
+        error = "couldn't open " + path.string();
+        return false;
+    }
+    const uint8_t* begin = static_cast<const uint8_t*>(file.getData());
+    const size_t size = file.getMappedSize();
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    const std::string ext = getLowerExtension(path);
+    bool ok = false;
+    if (ext == ".obj")
+        ok = loadObj(reinterpret_cast<const char*>(begin), reinterpret_cast<const char*>(begin) + size, data, error, threadCount);
+    else if (ext == ".stl")
+        ok = loadStl(begin, size, data, error, threadCount);
+    else
+        ok = loadPly(begin, size, data, error, threadCount);
+
+    if (ok && data.triangles.empty()) {
+        error = "no triangles";
+        ok = false;
+    }
+    if (!ok) {
+        error = path.filename().string() + ": " + error;
+        data = FlatMeshFileData();
+    }
+    return ok;
+}
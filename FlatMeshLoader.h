@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Utils/Math/Vector.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace Falcor;
+
+// Position-only triangle soup loaded straight from a mesh file, see FlatMesh::initFromFile.
+struct FlatMeshFileData {
+    std::vector<float3> triangles; // 3 vertices per triangle, the layout of MeshBufferTriangle in mesh.slang
+    float3 minCorner{ 0 };
+    float3 maxCorner{ 0 };
+};
+
+// OBJ, STL (binary and ASCII) and PLY (ASCII and binary) files are supported, decided by the extension
+bool isFlatMeshFileSupported(const std::filesystem::path& path);
+
+// Memory maps the file and parses it in parallel chunks, the triangles are written directly to `data.triangles`
+// and the bounds are reduced per thread. Polygons are triangulated as fans, every other attribute is skipped.
+// `threadCount` 0 uses every hardware thread.
+// returns false and sets `error` on failure
+bool loadFlatMeshFile(const std::filesystem::path& path, FlatMeshFileData& data, std::string& error, uint32_t threadCount = 0);
@@ -1,4 +1,6 @@
 #include "SDF.h"
+#include "FlatMeshLoader.h"
+#include "SDFFile.h"
 
 #include <fstream>
 
@@ -76,7 +78,7 @@ void SDF_TraceProgram_Desc::renderGui(Gui::Widgets& w)
     w.checkbox("Hard shadow", CALC_HARD_SHADOW);
     w.checkbox("Mirror back facing normals", MIRROR_BACK_NORMAL);
     w.checkbox("Discard fragments", DISCARD_MISS);
-    ImGui::BeginDisable(type.sdfType != SDF_Type::SDF0 && type.sdfType != SDF_Type::Procedural);
+    ImGui::BeginDisable(type.sdfType != SDF_Type::SDF0 && type.sdfType != SDF_Type::Procedural && type.sdfType != SDF_Type::SparseBrick && type.sdfType != SDF_Type::SDF1 && type.sdfType != SDF_Type::QuantizedBrick);
     if (w.button("1 SPHERE TRACE##SDF_FUN")) SDF_TRACE_FUN_NUM = 1;
     ImGui::HoverTooltip("Sphere trace");
     if (w.button("2 RELAXED##SDF_FUN", true)) SDF_TRACE_FUN_NUM = 2;
@@ -85,12 +87,26 @@ void SDF_TraceProgram_Desc::renderGui(Gui::Widgets& w)
     ImGui::HoverTooltip("Enhanced sphere trace");
     if (w.button("4 AUTO##SDF_FUN", true)) SDF_TRACE_FUN_NUM = 4;
     ImGui::HoverTooltip("Auto-relaxed sphere trace");
-    w.var("SDF_TRACE_FUN_NUM", SDF_TRACE_FUN_NUM, 1, 4, 1.f, false);
+    if (w.button("5 HIER##SDF_FUN", true)) SDF_TRACE_FUN_NUM = 5;
+    ImGui::HoverTooltip("Hierarchical sphere trace on the min. distance mips\n(SDF0 only, sphere trace otherwise)");
+    if (w.button("6 SEGMENT##SDF_FUN", true)) SDF_TRACE_FUN_NUM = 6;
+    ImGui::HoverTooltip("Segment trace with the Lipschitz bound of the procedural scene\n(sphere trace with growing segments otherwise)");
+    if (w.button("7 HINTED##SDF_FUN", true)) SDF_TRACE_FUN_NUM = 7;
+    ImGui::HoverTooltip("Auto-relaxed sphere trace that takes the slope and the Lipschitz bound\nfrom the step hint volume when it enters a brick (uses the auto param)");
+    w.var("SDF_TRACE_FUN_NUM", SDF_TRACE_FUN_NUM, 1, 7, 1.f, false);
     ImGui::EndDisable();
+    w.checkbox("Cone pre-pass", CONE_PREPASS);
+    ImGui::HoverTooltip("Start the primary rays from the conservative depth of a cone traced per 8x8 pixel tile");
+    w.checkbox("Temporal reprojection", TEMPORAL_REPROJECTION);
+    ImGui::HoverTooltip("Start the primary rays before the reprojected hit of the last frame if it is validated");
     w.checkbox("screen space normal", screenspaceNormal);
     ImGui::BeginDisable(screenspaceNormal);
+    w.checkbox("ANALYTIC_NORMAL", ANALYTIC_NORMAL);
+    ImGui::HoverTooltip("Gradient of the trilinear interpolation of the 8 corner texels for SDF0,\n4 tap tetrahedral differences for the other sources");
+    ImGui::BeginDisable(ANALYTIC_NORMAL);
     w.checkbox("FORWARD_DIFF_NORMAL", FORWARD_DIFF_NORMAL);
     ImGui::EndDisable();
+    ImGui::EndDisable();
     w.checkbox("ENABLE_DEBUG_UTILS", ENABLE_DEBUG_UTILS);
     ImGui::BeginDisable(!ENABLE_DEBUG_UTILS);
     if (w.button("0 OFF##DEB_COL")) DEBUG_COLORING = 0;
@@ -113,6 +129,7 @@ void ProceduralSDF::renderGui(Gui::Widgets& w) const
     ImGui::Text("File: %s", file.c_str());
     ImGui::Text("Default bounding box:");
     boundingBox.renderGuiConst(w);
+    ImGui::Text("Lipschitz bound: %g", lipschitz);
     ImGui::PopID();
 }
 
@@ -229,7 +246,14 @@ ProceduralSDFList ProceduralSDFList::fromFile(const std::filesystem::path& path)
         auto& c = desc.boundingBox.corner;
         auto& s = desc.boundingBox.size;
         ss >> desc.file >> c.x >> c.y >> c.z >> s.x >> s.y >> s.z;
-        if (!ss) {
+        bool ok = !ss.fail();
+        // optional column
+        float lipschitz;
+        if (ok && ss >> lipschitz)
+            desc.lipschitz = lipschitz;
+        else if (ok && !ss.eof())
+            ok = false;
+        if (!ok || !(desc.lipschitz > 0.f)) {
             const std::string errorMsg = "[ProceduralSDFList::fromFile] couldn't parse line " + std::to_string(lineNo) + ": \"" + line + "\"";
             msgBox("Error", errorMsg, MsgBoxType::Ok, MsgBoxIcon::Error);
         }
@@ -295,6 +319,9 @@ void SDF_DistanceSource_Desc::renderGui(const ref<Device>& pDevice, Gui::Widgets
         }
     }
     else if (sourceType == Source_Type::MeshCalc) {
+        Dropdown(w, "Calc. method", meshCalcMethod);
+        Dropdown(w, "Sign method", meshSignMethod);
+        HoverTooltip("WindingNumber is robust to holes in the mesh, ParityRays needs a watertight mesh");
         ref<TriangleMesh> newMesh;
         static float3 boxSide = float3(0.5f);
         static uint2 paramRes = uint2(10, 10);
@@ -308,17 +335,27 @@ void SDF_DistanceSource_Desc::renderGui(const ref<Device>& pDevice, Gui::Widgets
             newMesh = TriangleMesh::createSphere(boxSide.x, paramRes.x, paramRes.y);
             newMesh->setName("Sphere");
         }
+        bool loadedMesh = false;
         if (w.button("Load mesh from file...", true)) {
             std::filesystem::path path;
             if (openFileDialog({}, path))
             {
-                newMesh = TriangleMesh::createFromFile(path);
-                newMesh->setName(path.filename().string());
+                // OBJ, STL and PLY are loaded directly to the triangle soup
+                if (isFlatMeshFileSupported(path)) {
+                    std::string error;
+                    loadedMesh = mesh.initFromFile(pDevice, path, error);
+                    if (!loadedMesh)
+                        msgBox("Error", "[SDF_DistanceSource_Desc::renderGui] " + error, MsgBoxType::Ok, MsgBoxIcon::Error);
+                }
+                else {
+                    newMesh = TriangleMesh::createFromFile(path);
+                    newMesh->setName(path.filename().string());
+                }
             }
         }
 
-        if (newMesh) {
-            if (mesh.initFromMesh(pDevice, newMesh) && mesh.numTriangles != 0) {
+        if (newMesh || loadedMesh) {
+            if ((loadedMesh || mesh.initFromMesh(pDevice, newMesh)) && mesh.numTriangles != 0) {
                 float3 innerSize = mesh.maxCorner - mesh.minCorner;
                 float3 padding = innerSize / 6.f;
                 BBox bb;
@@ -340,6 +377,8 @@ void SDF_DistanceSource_Desc::renderGui(const ref<Device>& pDevice, Gui::Widgets
                 mesh.name.c_str(), mesh.numTriangles,
                 mesh.minCorner.x, mesh.minCorner.y, mesh.minCorner.z,
                 mesh.maxCorner.x, mesh.maxCorner.y, mesh.maxCorner.z);
+            if (mesh.bvhBuffer)
+                ImGui::Text("BVH nodes: %u", mesh.bvhNodeCount);
             if (w.button("Delete mesh")) {
                 mesh.reset();
             }
@@ -366,7 +405,7 @@ void SDF_Generation_Desc::renderGui(const ref<Device>& pDevice, Gui::Widgets& w,
     sourceDesc.renderGui(pDevice, w, &dataDesc.box, sdfList);
     if (sourceDesc.sourceType == Source_Type::MeshCalc) {
         auto t = dataDesc.type.sdfType;
-        if (t != SDF_Type::SDF0) {
+        if (t != SDF_Type::SDF0 && t != SDF_Type::SDF1) {
             ImGui::TextColored(ImVec4(1, 0, 0, 1), "Mesh input is unsupported for this SDF type.");
         }
     }
@@ -381,6 +420,22 @@ void SDF_Generation_Desc::renderGui(const ref<Device>& pDevice, Gui::Widgets& w,
     ImGui::PopStyleColor();
     w.checkbox("Keep source SDF", keepSource);
     ImGui::HoverTooltip("Keep the source SDF in a program state,\nand create the new SDF in a new state");
+    ImGui::BeginDisable(dataDesc.type.sdfType != SDF_Type::SDF0);
+    w.checkbox("Min. distance mips", minDistanceMips);
+    ImGui::HoverTooltip("Build a mip chain of conservative distance bounds\nfor the hierarchical tracer (5 HIER)");
+    ImGui::EndDisable();
+    ImGui::BeginDisable(dataDesc.type.sdfType != SDF_Type::QuantizedBrick);
+    w.var("Quantization band (cells)", quantizedBandCells, 0.f, 64.f, 0.25f);
+    ImGui::HoverTooltip("The distances of the bricks on the surface are clamped to this band,\nthe 8 bit samples have a precision of 2 * band / 255 cells there (0: no clamping)");
+    ImGui::EndDisable();
+    ImGui::BeginDisable(dataDesc.type.sdfType != SDF_Type::SDF0);
+    Dropdown(w, "Lipschitz fix", lipschitzFix);
+    ImGui::HoverTooltip("Correction of the cells where the distance changes faster than 1,\nthe tracers can step over the surface there (see the histogram of the SDF)\nRescale: divides every distance by the max. gradient\nReinitialize: eikonal reinitialization, lowers the distances that are too large for their neighbors\n(the histogram after the fix shows what is left)");
+    if (lipschitzFix == Lipschitz_Fix::Reinitialize) {
+        w.var("Reinit. iterations", lipschitzIterations, 1u, 1024u);
+        ImGui::HoverTooltip("The correction spreads one cell along the axes per iteration from the surface");
+    }
+    ImGui::EndDisable();
     w.separator();
 }
 
@@ -424,6 +479,14 @@ void Render_Settings::renderGui(Gui::Widgets& w, const SDF* activeSdf)
     w.var("auto param", autoParam, 0.01f, 0.99f, 0.001f, true);
     ImGui::HoverTooltip("Exponential averaging coefficient for relaxed sphere tracing");
 
+    if (w.button("1.5##segment", false)) { segmentParam = 1.5f; }
+    if (w.button("2.0##segment", true)) { segmentParam = 2.0f; }
+    w.var("segment param", segmentParam, 1.0f, 4.0f, 0.001f, true);
+    ImGui::HoverTooltip("Growth of the candidate segment after each step of segment tracing");
+
+    w.var("reprojection margin", reprojectionMargin, 0.0001f, 1.0f, 0.001f, true);
+    ImGui::HoverTooltip("The trace starts this far before the reprojected hit of the last frame (Temporal reprojection)");
+
     w.var("shade normal eps", shadeNormalEps, 0.0001f);
     if (activeSdf && w.button("Set to cell size", true)) {
         shadeNormalEps = activeSdf->desc.box.size / (float3)activeSdf->desc.resolution;
@@ -436,9 +499,65 @@ void Render_Settings::renderGui(Gui::Widgets& w, const SDF* activeSdf)
 
 }
 
+const char* getSdfSourceDefine(SDF_Type type)
+{
+    switch (type)
+    {
+    case SDF_Type::Procedural:
+        return "0";
+    case SDF_Type::SDF0:
+        return "1";
+    case SDF_Type::SparseBrick:
+        return "3";
+    case SDF_Type::SDF1:
+        return "4";
+    case SDF_Type::QuantizedBrick:
+        return "5";
+    default:
+        msgBox("Error", "[getSdfSourceDefine] Unsupported SDF_Type", MsgBoxType::Ok, MsgBoxIcon::Error);
+        return "1";
+    }
+}
+
+void SDF_Lipschitz_Stats::renderGui(Gui::Widgets& w, const char label[]) const
+{
+    if (!valid || cellCount == 0) return;
+    w.text(label);
+    ImGui::Text("Max. gradient: %.3f\nCells over %.2f: %llu / %llu (%.3f%%)", maxGradient, kTolerance,
+        (unsigned long long)violatingCells(), (unsigned long long)cellCount, 100.0 * double(violatingCells()) / double(cellCount));
+    ImGui::HoverTooltip("Max. gradient of the trilinear interpolation at the corners of the cells.\nThe tracers that assume a 1-Lipschitz field (relaxed, auto, segment)\ncan step over the surface in the cells over 1, more so with a larger parameter.\nExact distances measure a bit over 1 at their ridges, those are within the tolerance\nand are not corrected by the Lipschitz fix.");
+    for (uint i = 0; i < kBinCount; ++i) {
+        const float lo = i == 0 ? 0.f : kBinEdges[i - 1];
+        const double percent = 100.0 * double(bins[i]) / double(cellCount);
+        if (i + 1 < kBinCount)
+            ImGui::Text("%5.2f - %5.2f: %10u %7.3f%%", lo, kBinEdges[i], bins[i], percent);
+        else
+            ImGui::Text("%5.2f -      : %10u %7.3f%%", lo, bins[i], percent);
+    }
+}
+
 void SDF::renderGui(Gui::Widgets& w) const
 {
     ImGui::Text("Model name: %s", modelName.c_str());
+    if (desc.type.sdfType == SDF_Type::SparseBrick && texture && brickIndirection) {
+        const uint3 grid = desc.resolution / kSparseBrickSize;
+        const uint64_t texelBytes = desc.halfPrecision ? 2 : 4;
+        const double atlasMB = double(texelBytes * texture->getWidth() * texture->getHeight() * texture->getDepth()) / (1 << 20);
+        const double indirectionMB = double(8ull * grid.x * grid.y * grid.z) / (1 << 20);
+        const double denseMB = double(texelBytes * desc.resolution.x * desc.resolution.y * desc.resolution.z) / (1 << 20);
+        ImGui::Text("Bricks: %u / %u\nMemory: %.1f MB (dense: %.1f MB)", sparseBrickCount, grid.x * grid.y * grid.z, atlasMB + indirectionMB, denseMB);
+    }
+    if (desc.type.sdfType == SDF_Type::QuantizedBrick && texture && brickRange) {
+        const uint3 grid = desc.resolution / kQuantizedBrickSize;
+        const double atlasMB = double(texture->getWidth() * texture->getHeight() * texture->getDepth()) / (1 << 20);
+        const double rangeMB = double(8ull * grid.x * grid.y * grid.z) / (1 << 20);
+        const double halfMB = double(2ull * desc.resolution.x * desc.resolution.y * desc.resolution.z) / (1 << 20);
+        ImGui::Text("Memory: %.1f MB (dense 16 bit: %.1f MB)", atlasMB + rangeMB, halfMB);
+    }
+    if (desc.type.sdfType == SDF_Type::SDF0) {
+        lipschitzStats.renderGui(w, "Gradient histogram");
+        lipschitzFixedStats.renderGui(w, "After the Lipschitz fix");
+    }
     w.text("=== SDF descpriptor ===");
     desc.renderGuiConst(w);
     w.text("=== Current trace program ===");
@@ -457,12 +576,255 @@ void SDF::setModelParameters(const ShaderVar& rootVar) const
         modelCB["oneOverOuterBoxSize"] = 1.0f / desc.box.size;
         modelCB["resolution"] = desc.resolution;
         modelCB["resolution_r"] = 1.0f / float3(desc.resolution);
+        modelCB["modelTexMipCount"] = desc.type.sdfType == SDF_Type::SDF0 && texture ? texture->getMipCount() : 1u;
     }
 
-    if (desc.type.sdfType == SDF_Type::SDF0) {
+    if (desc.type.sdfType == SDF_Type::SDF0 || desc.type.sdfType == SDF_Type::SDF1) {
         auto texVar = rootVar.findMember("modelTex");
         if (texVar.isValid()) {
             texVar = texture;
         }
     }
+    else if (desc.type.sdfType == SDF_Type::SparseBrick && texture) {
+        auto brickCB = rootVar.findMember("BRICKcb");
+        if (brickCB.isValid()) {
+            const uint3 atlasCount = uint3(texture->getWidth(), texture->getHeight(), texture->getDepth()) / kSparseBrickTexels;
+            brickCB["brickGridSize"] = desc.resolution / kSparseBrickSize;
+            brickCB["brickAtlasCount"] = atlasCount;
+            brickCB["brickAtlasSize_r"] = 1.0f / float3(atlasCount * kSparseBrickTexels);
+        }
+        auto atlasVar = rootVar.findMember("brickAtlasTex");
+        if (atlasVar.isValid()) {
+            atlasVar = texture;
+        }
+        auto indirectionVar = rootVar.findMember("brickIndirectionTex");
+        if (indirectionVar.isValid()) {
+            indirectionVar = brickIndirection;
+        }
+    }
+    else if (desc.type.sdfType == SDF_Type::QuantizedBrick && texture) {
+        auto brickCB = rootVar.findMember("QBRICKcb");
+        if (brickCB.isValid()) {
+            const uint3 grid = desc.resolution / kQuantizedBrickSize;
+            brickCB["quantizedBrickGridSize"] = grid;
+            brickCB["quantizedAtlasSize_r"] = 1.0f / float3(grid * kQuantizedBrickTexels);
+        }
+        auto texVar = rootVar.findMember("modelTex");
+        if (texVar.isValid()) {
+            texVar = texture;
+        }
+        auto rangeVar = rootVar.findMember("brickRangeTex");
+        if (rangeVar.isValid()) {
+            rangeVar = brickRange;
+        }
+    }
+
+    // always bound, a cached trace program must not keep the hints of the previous SDF:
+    // without hints the texture reads 0, see Shaders/step_hint.slang
+    auto hintCB = rootVar.findMember("HINTcb");
+    if (hintCB.isValid()) {
+        hintCB["stepHintGridSize"] = stepHint ? uint3(stepHint->getWidth(), stepHint->getHeight(), stepHint->getDepth()) : uint3(0);
+    }
+    auto hintVar = rootVar.findMember("stepHintTex");
+    if (hintVar.isValid()) {
+        hintVar = stepHint; // a null texture if there are no hints
+    }
+}
+
+namespace {
+SDFFileFormat toSDFFileFormat(ResourceFormat format)
+{
+    switch (format)
+    {
+    case ResourceFormat::R16Float:
+        return SDFFileFormat::R16Float;
+    case ResourceFormat::R32Float:
+        return SDFFileFormat::R32Float;
+    case ResourceFormat::RGBA16Float:
+        return SDFFileFormat::RGBA16Float;
+    case ResourceFormat::RGBA32Float:
+        return SDFFileFormat::RGBA32Float;
+    case ResourceFormat::RG32Uint:
+        return SDFFileFormat::RG32Uint;
+    case ResourceFormat::R8Unorm:
+        return SDFFileFormat::R8Unorm;
+    case ResourceFormat::RG32Float:
+        return SDFFileFormat::RG32Float;
+    default:
+        return SDFFileFormat::Unknown;
+    }
+}
+ResourceFormat toResourceFormat(SDFFileFormat format)
+{
+    switch (format)
+    {
+    case SDFFileFormat::R16Float:
+        return ResourceFormat::R16Float;
+    case SDFFileFormat::R32Float:
+        return ResourceFormat::R32Float;
+    case SDFFileFormat::RGBA16Float:
+        return ResourceFormat::RGBA16Float;
+    case SDFFileFormat::RGBA32Float:
+        return ResourceFormat::RGBA32Float;
+    case SDFFileFormat::RG32Uint:
+        return ResourceFormat::RG32Uint;
+    case SDFFileFormat::R8Unorm:
+        return ResourceFormat::R8Unorm;
+    case SDFFileFormat::RG32Float:
+        return ResourceFormat::RG32Float;
+    default:
+        return ResourceFormat::Unknown;
+    }
+}
+}
+
+bool SDF::toFile(RenderContext* pContext, const std::filesystem::path& path) const
+{
+    if (sdfState != SDF_State::Complete) {
+        msgBox("Error", "[SDF::toFile] The SDF is not complete yet", MsgBoxType::Ok, MsgBoxIcon::Error);
+        return false;
+    }
+    SDFFile file;
+    auto& h = file.header;
+    h.sdfType = (uint32_t)desc.type.sdfType;
+    h.halfPrecision = desc.halfPrecision;
+    for (int i = 0; i < 3; ++i) {
+        h.resolution[i] = desc.resolution[i];
+        h.boxCorner[i] = desc.box.corner[i];
+        h.boxSize[i] = desc.box.size[i];
+        h.outputVoxelSize[i] = genDesc.outputVoxelSize[i];
+        h.proceduralBoxCorner[i] = programDesc.proceduralSDFDesc.boundingBox.corner[i];
+        h.proceduralBoxSize[i] = programDesc.proceduralSDFDesc.boundingBox.size[i];
+    }
+    h.sourceType = (uint32_t)genDesc.sourceDesc.sourceType;
+    file.modelName = modelName;
+    file.proceduralName = programDesc.proceduralSDFDesc.name;
+    file.proceduralFile = programDesc.proceduralSDFDesc.file;
+
+    std::vector<std::vector<uint8_t>> payloads;
+    auto addTexture = [&](const ref<Texture>& pTex, SDFFileTextureRole role) {
+        if (!pTex) return true;
+        SDFFileTexture tex{};
+        tex.role = (uint32_t)role;
+        tex.format = (uint32_t)toSDFFileFormat(pTex->getFormat());
+        if (tex.format == (uint32_t)SDFFileFormat::Unknown) {
+            msgBox("Error", "[SDF::toFile] Unsupported texture format", MsgBoxType::Ok, MsgBoxIcon::Error);
+            return false;
+        }
+        tex.width = pTex->getWidth();
+        tex.height = pTex->getHeight();
+        tex.depth = pTex->getDepth();
+        tex.mipLevels = pTex->getMipCount();
+        auto& payload = payloads.emplace_back();
+        payload.reserve(calcSDFFilePayloadSize(tex));
+        for (uint32_t mip = 0; mip < tex.mipLevels; ++mip) {
+            const auto data = pContext->readTextureSubresource(pTex.get(), pTex->getSubresourceIndex(0, mip));
+            payload.insert(payload.end(), data.begin(), data.end());
+        }
+        file.textures.push_back(tex);
+        return true;
+    };
+    if (!addTexture(texture, SDFFileTextureRole::Texture) || !addTexture(texture2, SDFFileTextureRole::Texture2)
+        || !addTexture(brickIndirection, SDFFileTextureRole::BrickIndirection) || !addTexture(brickRange, SDFFileTextureRole::BrickRange))
+        return false;
+
+    std::string error;
+    if (!file.write(path, payloads, error)) {
+        msgBox("Error", "[SDF::toFile] " + error, MsgBoxType::Ok, MsgBoxIcon::Error);
+        return false;
+    }
+    return true;
+}
+
+// SDFFile validates the files against these, a new value needs a new kSDFFileVersion
+static_assert((uint32_t)SDF_Type::QuantizedBrick + 1 == kSDFFileSdfTypeCount, "SDF_Type doesn't match the SDF file version");
+static_assert((uint32_t)Source_Type::MeshCalc + 1 == kSDFFileSourceTypeCount, "Source_Type doesn't match the SDF file version");
+static_assert(SDF::kSparseBrickSize == kSDFFileBrickSize && SDF::kSparseBrickTexels == kSDFFileBrickTexels, "sparse brick layout of the SDF file");
+static_assert(SDF::kQuantizedBrickSize == kSDFFileBrickSize && SDF::kQuantizedBrickTexels == kSDFFileBrickTexels, "quantized brick layout of the SDF file");
+
+std::shared_ptr<SDF> SDF::fromFile(const ref<Device>& pDevice, const std::filesystem::path& path, ProceduralSDFList* sdfList)
+{
+    SDFFile file;
+    std::string error;
+    if (!file.open(path, error)) {
+        msgBox("Error", "[SDF::fromFile] " + error, MsgBoxType::Ok, MsgBoxIcon::Error);
+        return nullptr;
+    }
+    const auto& h = file.header;
+    auto sdf = std::make_shared<SDF>();
+    sdf->desc.type.sdfType = (SDF_Type)h.sdfType;
+    sdf->desc.halfPrecision = h.halfPrecision != 0;
+    sdf->desc.resolution = uint3(h.resolution[0], h.resolution[1], h.resolution[2]);
+    sdf->desc.box.corner = float3(h.boxCorner[0], h.boxCorner[1], h.boxCorner[2]);
+    sdf->desc.box.size = float3(h.boxSize[0], h.boxSize[1], h.boxSize[2]);
+    sdf->modelName = file.modelName;
+
+    auto& proc = sdf->programDesc.proceduralSDFDesc;
+    proc.name = file.proceduralName;
+    proc.file = file.proceduralFile;
+    proc.boundingBox.corner = float3(h.proceduralBoxCorner[0], h.proceduralBoxCorner[1], h.proceduralBoxCorner[2]);
+    proc.boundingBox.size = float3(h.proceduralBoxSize[0], h.proceduralBoxSize[1], h.proceduralBoxSize[2]);
+    sdf->programDesc.type = sdf->desc.type;
+
+    sdf->genDesc.dataDesc = sdf->desc;
+    sdf->genDesc.sourceDesc.sourceType = (Source_Type)h.sourceType;
+    sdf->genDesc.outputVoxelSize = uint3(h.outputVoxelSize[0], h.outputVoxelSize[1], h.outputVoxelSize[2]);
+    sdf->genDesc.sourceDesc.proceduralFunction = nullptr;
+    if (sdfList) {
+        auto it = std::find_if(sdfList->sdfs.begin(), sdfList->sdfs.end(), [&](const auto& p) { return p.name == proc.name; });
+        if (it != sdfList->sdfs.end()) {
+            sdf->genDesc.sourceDesc.proceduralFunction = &(*it);
+            proc.lipschitz = it->lipschitz;
+        }
+    }
+
+    auto loadTexture = [&](SDFFileTextureRole role) -> ref<Texture> {
+        const int index = file.findTexture(role);
+        if (index < 0) return nullptr;
+        const auto& tex = file.textures[index];
+        const ResourceFormat format = toResourceFormat((SDFFileFormat)tex.format);
+        if (format == ResourceFormat::Unknown) {
+            msgBox("Error", "[SDF::fromFile] Unsupported texture format in " + path.string(), MsgBoxType::Ok, MsgBoxIcon::Error);
+            return nullptr;
+        }
+        return pDevice->createTexture3D(tex.width, tex.height, tex.depth, format, tex.mipLevels, file.getPayload(index),
+            ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    };
+    sdf->texture = loadTexture(SDFFileTextureRole::Texture);
+    sdf->texture2 = loadTexture(SDFFileTextureRole::Texture2);
+    sdf->brickIndirection = loadTexture(SDFFileTextureRole::BrickIndirection);
+    sdf->brickRange = loadTexture(SDFFileTextureRole::BrickRange);
+    if (sdf->desc.type.sdfType == SDF_Type::QuantizedBrick && !sdf->brickRange) {
+        msgBox("Error", "[SDF::fromFile] The file has no brick range texture: " + path.string(), MsgBoxType::Ok, MsgBoxIcon::Error);
+        return nullptr;
+    }
+    if (sdf->desc.type.sdfType == SDF_Type::SparseBrick) {
+        if (!sdf->brickIndirection) {
+            msgBox("Error", "[SDF::fromFile] The file has no brick indirection texture: " + path.string(), MsgBoxType::Ok, MsgBoxIcon::Error);
+            return nullptr;
+        }
+        // the allocated bricks are not listed in the file, count them in the indirection texture
+        const int index = file.findTexture(SDFFileTextureRole::BrickIndirection);
+        const uint* pIndirection = reinterpret_cast<const uint*>(file.getPayload(index));
+        const auto& tex = file.textures[index];
+        const size_t brickNum = (size_t)tex.width * tex.height * tex.depth;
+        const auto& atlasTex = file.textures[file.findTexture(SDFFileTextureRole::Texture)];
+        const size_t atlasBrickNum = (size_t)(atlasTex.width / kSparseBrickTexels) * (atlasTex.height / kSparseBrickTexels) * (atlasTex.depth / kSparseBrickTexels);
+        for (size_t i = 0; i < brickNum; ++i) {
+            // 1 + the index of the brick in the atlas, 0 for the bricks that are not allocated
+            const uint atlasIndex = pIndirection[2 * i + 1];
+            if (atlasIndex > atlasBrickNum) {
+                msgBox("Error", "[SDF::fromFile] A brick is outside of the brick atlas: " + path.string(), MsgBoxType::Ok, MsgBoxIcon::Error);
+                return nullptr;
+            }
+            sdf->sparseBrickCount += atlasIndex != 0 ? 1 : 0;
+        }
+    }
+    if (!sdf->texture && sdf->desc.type.sdfType != SDF_Type::Procedural) {
+        msgBox("Error", "[SDF::fromFile] The file has no SDF texture: " + path.string(), MsgBoxType::Ok, MsgBoxIcon::Error);
+        return nullptr;
+    }
+    // the renderer does the usual post processing (normal epsilon, camera) before tracing
+    sdf->sdfState = SDF_State::Postprocessing;
+    return sdf;
 }
@@ -12,6 +12,9 @@ class SDF;
 enum class SDF_Type {
     SDF0,                /* traditional order 0 Signed Distance Field         */
     Procedural,          /* Procedural function inside a bounding box         */
+    SparseBrick,         /* Order 0 SDF, only the bricks near the surface     */
+    SDF1,                /* Order 1 SDF: distance and gradient, cubic Hermite */
+    QuantizedBrick,      /* Order 0 SDF, 8 bit samples with a range per brick */
 };
 
 enum class Source_Type {
@@ -20,12 +23,38 @@ enum class Source_Type {
     MeshCalc,             /* distance from a loaded mesh          */
 };
 
+enum class Mesh_Calc_Method {
+    BruteForce,           /* every voxel against every triangle, sign from 3 parity rays */
+    BVH,                  /* closest point with a triangle BVH, sign from 1 parity ray   */
+    NarrowBand,           /* exact distance near the triangles, jump flooding elsewhere  */
+};
+
+enum class Mesh_Sign_Method {
+    ParityRays,           /* parity of the rays of the calc. method, needs a watertight mesh */
+    WindingNumber,        /* generalized winding number with the BVH, robust to holes        */
+};
+
+enum class Lipschitz_Fix {
+    None,                 /* only the histogram of the gradients is reported                  */
+    Rescale,              /* the distances are divided by the max. gradient                    */
+    Reinitialize,         /* eikonal reinitialization of the distances away from the surface   */
+};
+
+
+// value of the SDF_SOURCE define in the shaders (sdf.slang) for the SDF type
+const char* getSdfSourceDefine(SDF_Type type);
 
 bool Dropdown(Gui::Widgets& w, const char label[], SDF_Type& var, bool sameLine = false);
 bool Dropdown(Gui::Widgets& w, const char label[], Source_Type& var, bool sameLine = false);
+bool Dropdown(Gui::Widgets& w, const char label[], Mesh_Calc_Method& var, bool sameLine = false);
+bool Dropdown(Gui::Widgets& w, const char label[], Mesh_Sign_Method& var, bool sameLine = false);
+bool Dropdown(Gui::Widgets& w, const char label[], Lipschitz_Fix& var, bool sameLine = false);
 
 std::ostream& operator<<(std::ostream& os, SDF_Type val);
 std::ostream& operator<<(std::ostream& os, Source_Type val);
+std::ostream& operator<<(std::ostream& os, Mesh_Calc_Method val);
+std::ostream& operator<<(std::ostream& os, Mesh_Sign_Method val);
+std::ostream& operator<<(std::ostream& os, Lipschitz_Fix val);
 
 // CRTP
 template<typename Renderable>
@@ -84,6 +113,8 @@ struct ProceduralSDF {
     std::string name;
     std::string file;
     BBox boundingBox;
+    // bound of the rate of change of funDist, used by the segment tracer if the scene has no funLipschitz
+    float lipschitz = 1.f;
 
     void renderGui(Gui::Widgets& w) const;
 };
@@ -96,7 +127,7 @@ struct ProceduralSDFList {
 
     bool renderGui(Gui::Widgets& w);
 };
-struct SDF_TraceProgram_Desc : ConstRender<SDF_TraceProgram_Desc> {
+struct SDF_TraceProgram_Desc : ConstRender<SDF_TraceProgram_Desc>, hash_tuple::TupleHash<SDF_TraceProgram_Desc> {
     // SDF type
     SDF_Type_Desc type{};
 
@@ -111,9 +142,20 @@ struct SDF_TraceProgram_Desc : ConstRender<SDF_TraceProgram_Desc> {
     bool screenspaceNormal{ false };
     bool ENABLE_DEBUG_UTILS{ false };
     bool FORWARD_DIFF_NORMAL{ false };
+    bool ANALYTIC_NORMAL{ false };
+    bool CONE_PREPASS{ false };
+    bool TEMPORAL_REPROJECTION{ false };
     int DEBUG_COLORING = 0;
 
-    auto asTuple() const { return std::tie(type, SDF_TRACE_FUN_NUM, CALC_HARD_SHADOW, MIRROR_BACK_NORMAL, DISCARD_MISS, screenspaceNormal, ENABLE_DEBUG_UTILS, FORWARD_DIFF_NORMAL, DEBUG_COLORING); }
+    // the fields that change the compiled program (key of the trace program cache)
+    auto asTuple() const { return std::make_tuple(
+        type, SDF_TRACE_FUN_NUM, CALC_HARD_SHADOW, MIRROR_BACK_NORMAL, DISCARD_MISS, screenspaceNormal, ENABLE_DEBUG_UTILS,
+        FORWARD_DIFF_NORMAL && !screenspaceNormal && !ANALYTIC_NORMAL, ANALYTIC_NORMAL && !screenspaceNormal,
+        CONE_PREPASS, TEMPORAL_REPROJECTION,
+        ENABLE_DEBUG_UTILS ? DEBUG_COLORING : 0,
+        type.sdfType == SDF_Type::Procedural ? proceduralSDFDesc.file : std::string{},
+        type.sdfType == SDF_Type::Procedural ? proceduralSDFDesc.lipschitz : 0.f
+    ); }
 
     void renderGui(Gui::Widgets& w);
 };
@@ -146,14 +188,20 @@ struct SDF_DistanceSource_Desc : ConstRender<SDF_DistanceSource_Desc> {
     const ProceduralSDF* proceduralFunction;
     // Source_Type::MeshCalc
     FlatMesh mesh;
+    Mesh_Calc_Method meshCalcMethod = Mesh_Calc_Method::BVH;
+    Mesh_Sign_Method meshSignMethod = Mesh_Sign_Method::WindingNumber;
 
     void updatePointers(ProceduralSDFList* sdfList);
+    // the generation from the mesh traverses its BVH
+    bool needsMeshBVH() const { return sourceType == Source_Type::MeshCalc && (meshCalcMethod != Mesh_Calc_Method::BruteForce || meshSignMethod == Mesh_Sign_Method::WindingNumber); }
 
     auto asTuple() const { return std::make_tuple(
         sourceType,
         sourceType == Source_Type::ResampleSDF ? sdfToResample : nullptr,
         sourceType == Source_Type::ProceduralFunction ? proceduralFunction : nullptr,
-        sourceType == Source_Type::MeshCalc ? mesh.buffer : nullptr
+        sourceType == Source_Type::MeshCalc ? mesh.buffer : nullptr,
+        sourceType == Source_Type::MeshCalc ? meshCalcMethod : Mesh_Calc_Method::BruteForce,
+        sourceType == Source_Type::MeshCalc ? meshSignMethod : Mesh_Sign_Method::ParityRays
     ); }
 
     void renderGui(const ref<Device>& pDevice, Gui::Widgets& w, BBox* boxToSet, ProceduralSDFList* sdfList = nullptr);
@@ -167,8 +215,12 @@ struct SDF_Generation_Desc : ConstRender<SDF_Generation_Desc> {
     // run params
     uint3 outputVoxelSize{ 64 };
     bool keepSource = false;
+    bool minDistanceMips = true; // SDF0: mips >= 1 store lower bounds of the distance, see Shaders/computeMinMip.cs.slang
+    float quantizedBandCells = 2.f; // QuantizedBrick: the range of the bricks on the surface is clamped to +- this many cells (0: off)
+    Lipschitz_Fix lipschitzFix = Lipschitz_Fix::None; // SDF0: correction of the cells with a gradient > 1, see Shaders/computeLipschitz.cs.slang
+    uint lipschitzIterations = 32; // Lipschitz_Fix::Reinitialize: Jacobi iterations, the correction spreads one cell along the axes per iteration
 
-    auto asTuple() const { return std::tie(dataDesc, sourceDesc, outputVoxelSize, keepSource); }
+    auto asTuple() const { return std::tie(dataDesc, sourceDesc, outputVoxelSize, keepSource, minDistanceMips, quantizedBandCells, lipschitzFix, lipschitzIterations); }
 
     void renderGui(const ref<Device>& pDevice, Gui::Widgets& w, ProceduralSDFList* sdfList = nullptr, SDF* activeSDF = nullptr);
 };
@@ -183,6 +235,8 @@ struct Render_Settings : ConstRender<Render_Settings> {
     float relaxedParam{ 1.6f };
     float enhancedParam{ 0.88f };
     float autoParam{ 0.3f };
+    float segmentParam{ 1.5f };
+    float reprojectionMargin{ 0.01f };
     // shade settings
     float3 lightDir{ normalize(float3{ -1, -1, -1}) };
     float3 colorAmbient{ 0.01f };
@@ -190,11 +244,38 @@ struct Render_Settings : ConstRender<Render_Settings> {
     float3 shadeNormalEps{ 1.0f / 32.0f };
     float shadowNormalEps{ 0.001f };
 
-    auto asTuple() const { return std::tie(renderSDF, renderSDFBBox, primaryTraceStepNum, traceEpsilon, relaxedParam, enhancedParam, autoParam, lightDir, colorAmbient, colorDiffuse, shadeNormalEps, shadowNormalEps); }
+    auto asTuple() const { return std::tie(renderSDF, renderSDFBBox, primaryTraceStepNum, traceEpsilon, relaxedParam, enhancedParam, autoParam, segmentParam, reprojectionMargin, lightDir, colorAmbient, colorDiffuse, shadeNormalEps, shadowNormalEps); }
 
     void renderGui(Gui::Widgets& w, const SDF* activeSdf = nullptr);
 };
 
+// histogram of the gradients of the cells of an SDF0, see lipschitzMeasure_main in Shaders/computeLipschitz.cs.slang
+struct SDF_Lipschitz_Stats {
+    static constexpr uint kBinCount = 8;
+    // upper edges of the bins, the last bin has no upper edge
+    static constexpr float kBinEdges[kBinCount - 1] = { 1.f, 1.05f, 1.1f, 1.25f, 1.5f, 2.f, 4.f };
+    // The trilinear interpolation of an exact SDF measures a bit over 1 at the ridges of the distance (~1.03),
+    // the cells up to this bin are not counted as violations, so correct fields are not rescaled.
+    static constexpr uint kToleranceBin = 1;
+    static constexpr float kTolerance = kBinEdges[kToleranceBin];
+
+    bool valid = false;
+    uint64_t cellCount = 0;
+    uint bins[kBinCount] = {};
+    float maxGradient = 0.f;
+
+    // cells that can make the sphere tracers overstep (gradient over kTolerance)
+    uint64_t violatingCells() const
+    {
+        uint64_t n = cellCount;
+        for (uint i = 0; i <= kToleranceBin; ++i)
+            n -= bins[i];
+        return n;
+    }
+
+    void renderGui(Gui::Widgets& w, const char label[]) const;
+};
+
 enum class SDF_State {
     Empty,
     Generating,
@@ -209,15 +290,39 @@ public:
         : desc(_desc), modelName(_name), texture(_texture), programDesc(_progDesc) {}
     SDF_Data_Desc desc;
     std::string modelName;
-    ref<Texture> texture;
+    ref<Texture> texture;  // SDF_Type::SparseBrick, QuantizedBrick: the brick atlas
     ref<Texture> texture2;
     ref<Buffer> buffer;
+    // SDF_Type::SparseBrick, see Shaders/sparse_brick.slang
+    static constexpr uint kSparseBrickSize = 8;   // cells per brick side
+    static constexpr uint kSparseBrickTexels = 9; // samples per brick side
+    ref<Texture> brickIndirection;
+    uint sparseBrickCount = 0;
+    // SDF_Type::QuantizedBrick, see Shaders/quantized_brick.slang
+    static constexpr uint kQuantizedBrickSize = 8;   // cells per brick side
+    static constexpr uint kQuantizedBrickTexels = 9; // samples per brick side
+    ref<Texture> brickRange; // min. and scale of the samples per brick
+    // SDF_Type::SDF0, measured in ProgramState::PostProcess
+    SDF_Lipschitz_Stats lipschitzStats;      // of the generated or loaded field
+    SDF_Lipschitz_Stats lipschitzFixedStats; // after genDesc.lipschitzFix
+    bool lipschitzFixPending = false;        // a new generation, the cached and loaded ones are already corrected
+    // step hints of the hinted tracer (SDF_TRACE_FUN_NUM 7), see Shaders/step_hint.slang
+    static constexpr uint kStepHintBrickSize = 8;            // cells of the SDF per brick side
+    static constexpr uint kProceduralStepHintGridSize = 32;  // bricks per side of the box of a procedural SDF
+    ref<Texture> stepHint;
     SDF_TraceProgram_Desc programDesc;
     SDF_Generation_Desc genDesc;
     SDF_State sdfState = SDF_State::Empty;
-
+    // key of the generation in the SDFCache, empty if the source couldn't be identified
+    std::string cacheKey;
 
     void renderGui(Gui::Widgets& w) const;
 
     void setModelParameters(const ShaderVar& rootVar) const;
+
+    // save the descriptors and the textures to an SDFFile
+    bool toFile(RenderContext* pContext, const std::filesystem::path& path) const;
+    // load an SDFFile saved by `toFile`, the textures are uploaded straight from the mapped file
+    // sdfList: used to restore the procedural function of the generation descriptor
+    static std::shared_ptr<SDF> fromFile(const ref<Device>& pDevice, const std::filesystem::path& path, ProceduralSDFList* sdfList = nullptr);
 };
@@ -0,0 +1,525 @@
+// Headless benchmark of the sphere tracers on the CPU reference tracer (CpuTracer.h).
+// Runs the cross product of the scenes, cameras, tracers and trace parameters listed in a config file
+// (see Data/benchmark.txt) and writes timing, step statistics and convergence counts as CSV or JSON.
+// Only what has a CPU port is measured: tracers 1-4 and 7, the procedural scenes of findProceduralFunction and
+// SDF0, SDF1 and QuantizedBrick files. Anything else in the config is an error, not skipped, so the numbers
+// always cover the whole config. The GPU tracers and shaders are measured in SDFRenderer with the flythrough
+// benchmark (FlythroughTester).
+//
+// usage: SDFBenchmark <config> [--output <file.csv|file.json>] [--format csv|json]
+// Without --output the results are written to stdout as CSV.
+
+#include "CpuTracer.h"
+#include "SDFFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using namespace cpu_trace;
+
+namespace
+{
+struct Scene
+{
+    std::string name;
+    std::string source;                   // file of the procedural function or path of the SDF file
+    Model model;
+    std::shared_ptr<DistanceSource> pSource;
+    float3 normalEps{ 1e-4f };            // shadeNormalEps, see SDFRenderer::ProgramState::PostProcess
+    uint3 stepHintGridSize{ StepHintVolume::kProceduralGridSize }; // see SDFRenderer::buildStepHints
+    std::shared_ptr<StepHintVolume> pStepHints; // baked if tracer 7 is run
+};
+
+struct NamedCamera
+{
+    std::string name;
+    Camera camera;
+};
+
+struct Benchmark_Desc
+{
+    std::filesystem::path sceneList = "proceduralSDFList.txt";
+    std::filesystem::path cameraList = "cameraPositions.txt";
+    std::vector<std::string> scenes;    // of the scene list, required unless only sdfFiles are run
+    std::vector<std::filesystem::path> sdfFiles;
+    std::vector<std::string> cameras;   // empty: the camera with the name of the scene
+    std::vector<int> tracers{ 1, 2, 3, 4 };
+    // step relaxation parameters of tracers 2, 3, 4, 7 (defaults of Render_Settings)
+    std::map<int, std::vector<float>> params{ { 2, { 1.6f } }, { 3, { 0.88f } }, { 4, { 0.3f } }, { 7, { 0.3f } } };
+    std::vector<float> epsilons{ 0.0001f };
+    std::vector<int> maxSteps{ 100 };
+    std::vector<int> packets{ 0 };      // 1: ray packets for tracer 4
+    std::vector<NormalMode> normals{ NormalMode::None };
+    uint3 resolution{ 64 };             // inner box of the procedural scenes, same as SDF_Data_Desc::resolution
+    uint2 frameSize{ 1920u, 1080u };
+    float fovY = 1.0391f;               // vertical field of view of Falcor's default camera
+    uint threadCount = 0;
+    uint warmup = 1;
+    uint repeats = 3;
+};
+
+struct Result
+{
+    std::string scene;
+    std::string source;
+    std::string camera;
+    int tracer = 0;
+    float param = 0.f;
+    float epsilon = 0.f;
+    int maxSteps = 0;
+    bool packets = false;
+    NormalMode normals = NormalMode::None;
+    std::vector<double> timesMs;
+    ConvergenceCounts counts;
+    PacketStats packetStats;
+    NormalStats normalStats;
+};
+
+const char* kNormalModeNames[] = { "none", "central", "forward", "analytic" };
+
+bool parseNormalMode(const std::string& name, NormalMode& mode)
+{
+    for (size_t i = 0; i < std::size(kNormalModeNames); ++i) {
+        if (name == kNormalModeNames[i]) {
+            mode = NormalMode(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T>
+bool readValues(std::istream& is, std::vector<T>& values)
+{
+    values.clear();
+    T v;
+    while (is >> v)
+        values.push_back(v);
+    return !values.empty() && is.eof();
+}
+
+// same line format as Data/proceduralSDFList.txt: key followed by its values, lines starting with // are comments
+bool parseConfig(const std::filesystem::path& path, Benchmark_Desc& desc)
+{
+    std::ifstream fin(path);
+    if (!fin) {
+        std::cerr << "couldn't open config " << path << "\n";
+        return false;
+    }
+    const auto dir = path.parent_path();
+    desc.sceneList = dir / desc.sceneList;
+    desc.cameraList = dir / desc.cameraList;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(fin, line)) {
+        lineNo++;
+        std::stringstream ss(line);
+        std::string key;
+        ss >> key;
+        if (!ss || key.empty() || key[0] == '/')
+            continue;
+        bool ok = true;
+        std::vector<std::string> strings;
+        std::vector<uint> uints;
+        if (key == "sceneList" || key == "cameraList") {
+            ok = readValues(ss, strings) && strings.size() == 1;
+            if (ok) (key == "sceneList" ? desc.sceneList : desc.cameraList) = dir / strings[0];
+        }
+        else if (key == "scenes") ok = readValues(ss, desc.scenes);
+        else if (key == "cameras") ok = readValues(ss, desc.cameras);
+        else if (key == "sdfFiles") {
+            ok = readValues(ss, strings);
+            for (const auto& s : strings)
+                desc.sdfFiles.push_back(dir / s);
+        }
+        else if (key == "tracers") {
+            ok = readValues(ss, desc.tracers);
+            for (int t : desc.tracers) {
+                if (ok && !SDFTracer::hasTraceFunction(t)) {
+                    std::cerr << path.string() << ":" << lineNo << ": tracer " << t << " has no CPU port (1 2 3 4 7 have one)\n";
+                    return false;
+                }
+            }
+        }
+        else if (key == "relaxed") ok = readValues(ss, desc.params[2]);
+        else if (key == "enhanced") ok = readValues(ss, desc.params[3]);
+        else if (key == "auto") ok = readValues(ss, desc.params[4]);
+        else if (key == "hinted") ok = readValues(ss, desc.params[7]);
+        else if (key == "epsilons") ok = readValues(ss, desc.epsilons);
+        else if (key == "maxSteps") ok = readValues(ss, desc.maxSteps);
+        else if (key == "packets") ok = readValues(ss, desc.packets);
+        else if (key == "normals") {
+            ok = readValues(ss, strings);
+            desc.normals.resize(strings.size());
+            for (size_t i = 0; i < strings.size(); ++i)
+                ok = ok && parseNormalMode(strings[i], desc.normals[i]);
+        }
+        else if (key == "resolution") {
+            ok = readValues(ss, uints) && uints.size() == 1;
+            if (ok) desc.resolution = uint3(uints[0]);
+        }
+        else if (key == "frameSize") {
+            ok = readValues(ss, uints) && uints.size() == 2;
+            if (ok) desc.frameSize = uint2(uints[0], uints[1]);
+        }
+        else if (key == "fovY") ok = bool(ss >> desc.fovY);
+        else if (key == "threads") ok = bool(ss >> desc.threadCount);
+        else if (key == "warmup") ok = bool(ss >> desc.warmup);
+        else if (key == "repeats") ok = bool(ss >> desc.repeats) && desc.repeats > 0;
+        else {
+            std::cerr << path.string() << ":" << lineNo << ": unknown key \"" << key << "\"\n";
+            return false;
+        }
+        if (!ok) {
+            std::cerr << path.string() << ":" << lineNo << ": couldn't parse line \"" << line << "\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// the `scenes` of Data/proceduralSDFList.txt
+// returns false if no scene is listed, or a listed scene is unknown or has no CPU port
+bool loadProceduralScenes(const Benchmark_Desc& desc, std::vector<Scene>& scenes)
+{
+    std::ifstream fin(desc.sceneList);
+    if (!fin) {
+        std::cerr << "couldn't open scene list " << desc.sceneList << "\n";
+        return false;
+    }
+    std::map<std::string, Scene> all;
+    std::vector<std::string> unported;
+    std::string line;
+    while (std::getline(fin, line)) {
+        std::stringstream ss(line);
+        Scene scene;
+        float3 c, s;
+        ss >> scene.name;
+        if (!ss || scene.name.empty() || scene.name[0] == '/')
+            continue;
+        ss >> scene.source >> c.x >> c.y >> c.z >> s.x >> s.y >> s.z;
+        if (!ss) {
+            std::cerr << "couldn't parse scene \"" << scene.name << "\" in " << desc.sceneList << "\n";
+            return false;
+        }
+        auto fun = findProceduralFunction(scene.name);
+        if (!fun) {
+            unported.push_back(scene.name);
+            continue;
+        }
+        scene.model = Model::create(c, s, desc.resolution);
+        scene.pSource = std::make_shared<ProceduralSource>(fun, c, s);
+        all[scene.name] = scene;
+    }
+    if (desc.scenes.empty()) {
+        std::cerr << "list the scenes to run with `scenes`, the ones with a CPU port are:";
+        for (const auto& [name, scene] : all)
+            std::cerr << " " << name;
+        std::cerr << "\n";
+        return false;
+    }
+    bool ok = true;
+    for (const auto& name : desc.scenes) {
+        auto it = all.find(name);
+        if (it != all.end())
+            scenes.push_back(it->second);
+        else if (std::find(unported.begin(), unported.end(), name) != unported.end()) {
+            std::cerr << "scene \"" << name << "\" has no CPU port (see findProceduralFunction in CpuTracer.cpp)\n";
+            ok = false;
+        }
+        else {
+            std::cerr << "scene \"" << name << "\" is not in the scene list " << desc.sceneList << "\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool loadSDFFileScene(const std::filesystem::path& path, Scene& scene)
+{
+    SDFFile file;
+    std::string error;
+    if (!file.open(path, error)) {
+        std::cerr << "couldn't load " << path << ": " << error << "\n";
+        return false;
+    }
+    auto pGrid = createFileSource(file, scene.model, error);
+    if (!pGrid) {
+        std::cerr << "couldn't load " << path << ": " << error << "\n";
+        return false;
+    }
+    scene.name = file.modelName.empty() ? path.stem().string() : file.modelName;
+    scene.source = path.string();
+    scene.pSource = std::move(pGrid);
+    // the cell size of baked SDFs
+    scene.normalEps = scene.model.innerBoxSize / float3(scene.model.resolution);
+    scene.stepHintGridSize = (scene.model.resolution + StepHintVolume::kBrickSize - 1u) / StepHintVolume::kBrickSize;
+    return true;
+}
+
+// Data/cameraPositions.txt
+std::map<std::string, Camera> loadCameras(const Benchmark_Desc& desc)
+{
+    std::map<std::string, Camera> cameras;
+    std::ifstream fin(desc.cameraList);
+    if (!fin) {
+        std::cerr << "couldn't open camera list " << desc.cameraList << "\n";
+        return cameras;
+    }
+    std::string line;
+    while (std::getline(fin, line)) {
+        std::stringstream ss(line);
+        std::string name;
+        ss >> name;
+        if (!ss || name.empty() || name[0] == '/')
+            continue;
+        Camera cam;
+        auto& p = cam.position;
+        auto& a = cam.target;
+        auto& u = cam.up;
+        ss >> p.x >> p.y >> p.z >> a.x >> a.y >> a.z >> u.x >> u.y >> u.z;
+        if (!ss)
+            continue;
+        cam.fovY = desc.fovY;
+        cam.nearPlane = 0.001f; // SDFRenderer::onLoad
+        cameras[name] = cam;
+    }
+    return cameras;
+}
+
+Result runBenchmark(const Scene& scene, const NamedCamera& cam, const Render_Desc& rd, float param, const Benchmark_Desc& desc)
+{
+    SDFTracer tracer(scene.model, *scene.pSource);
+    tracer.setStepHints(scene.pStepHints.get());
+    Result res;
+    res.scene = scene.name;
+    res.source = scene.source;
+    res.camera = cam.name;
+    res.tracer = rd.traceFunNum;
+    res.param = param;
+    res.epsilon = rd.params.epsilon;
+    res.maxSteps = rd.params.maxiters;
+    res.packets = rd.usePackets;
+    res.normals = rd.normalMode;
+    for (uint i = 0; i < desc.warmup; ++i)
+        render(tracer, cam.camera, rd);
+    for (uint i = 0; i < desc.repeats; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        Frame frame = render(tracer, cam.camera, rd);
+        const auto end = std::chrono::steady_clock::now();
+        res.timesMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        // the frames are identical, the statistics of the last one are kept
+        res.counts = frame.counts;
+        res.packetStats = frame.packetStats;
+    }
+    if (rd.normalMode != NormalMode::None) {
+        // untimed frame for the error of the normals
+        Render_Desc measureDesc = rd;
+        measureDesc.measureNormalError = true;
+        res.normalStats = render(tracer, cam.camera, measureDesc).normalStats;
+    }
+    return res;
+}
+
+struct TimeStats
+{
+    double min, median, mean;
+};
+TimeStats calcTimeStats(std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double t : times)
+        sum += t;
+    const size_t n = times.size();
+    const double median = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    return { times.front(), median, sum / n };
+}
+
+double safeDiv(uint64_t a, uint64_t b) { return b == 0 ? 0.0 : double(a) / double(b); }
+
+constexpr double kDegreesPerRadian = 57.29577951308232;
+double normalErrorDegMean(const NormalStats& s) { return s.hitCount == 0 ? 0.0 : kDegreesPerRadian * s.angleSum / double(s.hitCount); }
+double normalErrorDegMax(const NormalStats& s) { return kDegreesPerRadian * s.angleMax; }
+
+std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+void writeCsv(std::ostream& os, const std::vector<Result>& results)
+{
+    os << "scene,source,camera,tracer,param,epsilon,maxSteps,packets,normals,"
+          "timeMsMin,timeMsMedian,timeMsMean,"
+          "covered,hit,miss,nonConverged,avgSteps,avgBackSteps,stepSum,backStepSum,packetLaneUtilization,"
+          "normalErrorDegMean,normalErrorDegMax\n";
+    for (const auto& r : results) {
+        const auto t = calcTimeStats(r.timesMs);
+        const auto& c = r.counts;
+        os << r.scene << ',' << r.source << ',' << r.camera << ',' << r.tracer << ',' << r.param << ',' << r.epsilon << ','
+           << r.maxSteps << ',' << (r.packets ? 1 : 0) << ',' << kNormalModeNames[int(r.normals)] << ','
+           << t.min << ',' << t.median << ',' << t.mean << ','
+           << c.coveredCount << ',' << c.convergedHitCount << ',' << c.convergedMissCount << ',' << c.nonConvergedCount << ','
+           << safeDiv(c.stepSum, c.coveredCount) << ',' << safeDiv(c.backStepSum, c.coveredCount) << ','
+           << c.stepSum << ',' << c.backStepSum << ','
+           << safeDiv(r.packetStats.activeLaneCount, r.packetStats.iterationCount * getPacketWidth()) << ','
+           << normalErrorDegMean(r.normalStats) << ',' << normalErrorDegMax(r.normalStats) << '\n';
+    }
+}
+
+void writeJson(std::ostream& os, const std::vector<Result>& results, const Benchmark_Desc& desc)
+{
+    os << "{\n  \"backend\": \"cpu\",\n"
+       << "  \"packetWidth\": " << getPacketWidth() << ",\n"
+       << "  \"threads\": " << (desc.threadCount != 0 ? desc.threadCount : std::max(std::thread::hardware_concurrency(), 1u)) << ",\n"
+       << "  \"frameSize\": [" << desc.frameSize.x << ", " << desc.frameSize.y << "],\n"
+       << "  \"warmup\": " << desc.warmup << ",\n"
+       << "  \"repeats\": " << desc.repeats << ",\n"
+       << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        const auto t = calcTimeStats(r.timesMs);
+        const auto& c = r.counts;
+        const auto& p = r.packetStats;
+        os << (i == 0 ? "\n" : ",\n") << "    {"
+           << "\"scene\": \"" << jsonEscape(r.scene) << "\", \"source\": \"" << jsonEscape(r.source) << "\", \"camera\": \"" << jsonEscape(r.camera) << "\", "
+           << "\"tracer\": " << r.tracer << ", \"param\": " << r.param << ", \"epsilon\": " << r.epsilon << ", "
+           << "\"maxSteps\": " << r.maxSteps << ", \"packets\": " << (r.packets ? "true" : "false")
+           << ", \"normals\": \"" << kNormalModeNames[int(r.normals)] << "\",\n     "
+           << "\"timeMs\": {\"min\": " << t.min << ", \"median\": " << t.median << ", \"mean\": " << t.mean << "},\n     "
+           << "\"covered\": " << c.coveredCount << ", \"hit\": " << c.convergedHitCount << ", \"miss\": " << c.convergedMissCount
+           << ", \"nonConverged\": " << c.nonConvergedCount << ", \"stepSum\": " << c.stepSum << ", \"backStepSum\": " << c.backStepSum;
+        if (r.packets) {
+            os << ",\n     \"packetStats\": {\"rays\": " << p.rayCount << ", \"lanes\": " << p.laneCount << ", \"iterations\": " << p.iterationCount
+               << ", \"activeLanes\": " << p.activeLaneCount << ", \"backStepLanes\": " << p.backStepLaneCount
+               << ", \"divergentBackSteps\": " << p.divergentBackStepCount << "}";
+        }
+        if (r.normals != NormalMode::None) {
+            os << ",\n     \"normalErrorDeg\": {\"hits\": " << r.normalStats.hitCount << ", \"mean\": " << normalErrorDegMean(r.normalStats)
+               << ", \"max\": " << normalErrorDegMax(r.normalStats) << "}";
+        }
+        os << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path configPath;
+    std::filesystem::path outputPath;
+    std::string format;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--format" && i + 1 < argc) format = argv[++i];
+        else if (configPath.empty() && arg.rfind("--", 0) != 0) configPath = arg;
+        else {
+            std::cerr << "usage: SDFBenchmark <config> [--output <file.csv|file.json>] [--format csv|json]\n";
+            return 1;
+        }
+    }
+    if (configPath.empty()) {
+        std::cerr << "usage: SDFBenchmark <config> [--output <file.csv|file.json>] [--format csv|json]\n";
+        return 1;
+    }
+    if (format.empty())
+        format = outputPath.extension() == ".json" ? "json" : "csv";
+    if (format != "csv" && format != "json") {
+        std::cerr << "unknown output format \"" << format << "\"\n";
+        return 1;
+    }
+
+    Benchmark_Desc desc;
+    if (!parseConfig(configPath, desc))
+        return 1;
+
+    // everything in the config is run or it's an error, so the results always cover the whole config
+    bool loaded = true;
+    std::vector<Scene> scenes;
+    if (!desc.scenes.empty() || desc.sdfFiles.empty())
+        loaded = loadProceduralScenes(desc, scenes);
+    for (const auto& path : desc.sdfFiles) {
+        Scene scene;
+        if (loadSDFFileScene(path, scene))
+            scenes.push_back(std::move(scene));
+        else
+            loaded = false;
+    }
+    const auto cameras = loadCameras(desc);
+    for (const auto& scene : scenes) {
+        for (const auto& name : desc.cameras.empty() ? std::vector<std::string>{ scene.name } : desc.cameras) {
+            if (cameras.find(name) == cameras.end()) {
+                std::cerr << "camera \"" << name << "\" of scene \"" << scene.name << "\" is not in the camera list " << desc.cameraList << "\n";
+                loaded = false;
+            }
+        }
+    }
+    if (!loaded)
+        return 1;
+    if (std::find(desc.tracers.begin(), desc.tracers.end(), 7) != desc.tracers.end()) {
+        for (auto& scene : scenes)
+            scene.pStepHints = std::make_shared<StepHintVolume>(*scene.pSource, scene.stepHintGridSize, scene.model.outerBoxSize, desc.threadCount);
+    }
+
+    std::vector<Result> results;
+    for (const auto& scene : scenes) {
+        std::vector<NamedCamera> sceneCameras;
+        for (const auto& name : desc.cameras.empty() ? std::vector<std::string>{ scene.name } : desc.cameras)
+            sceneCameras.push_back({ name, cameras.at(name) });
+        for (const auto& cam : sceneCameras)
+        for (int tracer : desc.tracers)
+        for (float param : tracer == 1 ? std::vector<float>{ 0.f } : desc.params[tracer])
+        for (float epsilon : desc.epsilons)
+        for (int maxSteps : desc.maxSteps)
+        for (int packets : desc.packets)
+        for (NormalMode normals : desc.normals) {
+            if (packets && tracer != 4)
+                continue;
+            Render_Desc rd;
+            rd.frameSize = desc.frameSize;
+            rd.traceFunNum = tracer;
+            rd.params.epsilon = epsilon;
+            rd.params.maxiters = maxSteps;
+            rd.params.stepRelaxation = param;
+            rd.threadCount = desc.threadCount;
+            rd.usePackets = packets != 0;
+            rd.normalMode = normals;
+            rd.normalEps = scene.normalEps;
+            std::cerr << scene.name << " / " << cam.name << ": tracer " << tracer << ", param " << param
+                      << ", epsilon " << epsilon << ", max. steps " << maxSteps << (rd.usePackets ? ", packets" : "")
+                      << (normals != NormalMode::None ? std::string(", normals ") + kNormalModeNames[int(normals)] : std::string{}) << "\n";
+            results.push_back(runBenchmark(scene, cam, rd, param, desc));
+        }
+    }
+    if (results.empty()) {
+        std::cerr << "nothing to run\n";
+        return 1;
+    }
+
+    std::ofstream fout;
+    if (!outputPath.empty()) {
+        fout.open(outputPath);
+        if (!fout) {
+            std::cerr << "couldn't open " << outputPath << " for writing\n";
+            return 1;
+        }
+    }
+    std::ostream& os = outputPath.empty() ? std::cout : fout;
+    if (format == "json")
+        writeJson(os, results, desc);
+    else
+        writeCsv(os, results);
+    return os ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include "SDFCache.h"
+#include "SDFFile.h"
+#include "Utils/fnv1a.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+// the procedural functions are included from the shader directory, see PROCEDURAL_FUNCTION_FILE in sdf.slang
+const std::filesystem::path kShaderDirectory = "shaders/Samples/SDFRenderer/Shaders";
+
+// the shaders of the generation, the post processing that is stored in the files (min. distance mips,
+// Lipschitz fix) and the SDF sampling used by the resampling, with the files they include
+const char* const kGenerationShaders[] = {
+    "computeSDF.cs.slang",
+    "computeFromMesh.cs.slang",
+    "computeNarrowBand.cs.slang",
+    "computeSparseBrick.cs.slang",
+    "computeQuantizedBrick.cs.slang",
+    "computeMinMip.cs.slang",
+    "computeLipschitz.cs.slang",
+    "mesh.slang",
+    "sdf.slang",
+    "sdf_model.slang",
+    "sparse_brick.slang",
+    "hermite.slang",
+    "quantized_brick.slang",
+    "SDFScenes/sphere.slang",
+};
+
+bool hashFile(FNV1a& hash, const std::filesystem::path& path)
+{
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin) return false;
+    std::stringstream ss;
+    ss << fin.rdbuf();
+    hash.addString(ss.str());
+    return true;
+}
+}
+
+std::string SDFCache::computeKey(const SDF_Generation_Desc& genDesc)
+{
+    FNV1a hash;
+    hash.addValue(kSDFFileVersion);
+    hash.addValue(kGeneratorVersion);
+    for (const char* shader : kGenerationShaders) {
+        if (!hashFile(hash, getRuntimeDirectory() / kShaderDirectory / shader)) return {};
+    }
+
+    const auto& data = genDesc.dataDesc;
+    hash.addValue(data.type.sdfType);
+    hash.addValue(data.halfPrecision);
+    hash.addValue(data.resolution);
+    hash.addValue(data.box.corner);
+    hash.addValue(data.box.size);
+    hash.addValue(data.type.sdfType == SDF_Type::SDF0 && genDesc.minDistanceMips);
+    hash.addValue(data.type.sdfType == SDF_Type::QuantizedBrick ? genDesc.quantizedBandCells : 0.f);
+    hash.addValue(data.type.sdfType == SDF_Type::SDF0 ? genDesc.lipschitzFix : Lipschitz_Fix::None);
+    hash.addValue(data.type.sdfType == SDF_Type::SDF0 && genDesc.lipschitzFix == Lipschitz_Fix::Reinitialize ? genDesc.lipschitzIterations : 0u);
+
+    const auto& source = genDesc.sourceDesc;
+    hash.addValue(source.sourceType);
+    switch (source.sourceType)
+    {
+    case Source_Type::ProceduralFunction:
+        if (!source.proceduralFunction) return {};
+        hash.addString(source.proceduralFunction->name);
+        hash.addString(source.proceduralFunction->file);
+        if (!hashFile(hash, getRuntimeDirectory() / kShaderDirectory / source.proceduralFunction->file)) return {};
+        break;
+    case Source_Type::MeshCalc:
+        if (source.mesh.numTriangles == 0) return {};
+        hash.addValue(source.mesh.contentHash);
+        hash.addValue(source.meshCalcMethod);
+        hash.addValue(source.meshSignMethod);
+        break;
+    case Source_Type::ResampleSDF:
+        // SDFs loaded from files or generated without a key can't be identified
+        if (!source.sdfToResample || source.sdfToResample->cacheKey.empty()) return {};
+        hash.addString(source.sdfToResample->cacheKey);
+        break;
+    default:
+        return {};
+    }
+
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash.get();
+    return ss.str();
+}
+
+std::shared_ptr<SDF> SDFCache::load(const ref<Device>& pDevice, const std::string& key, ProceduralSDFList* sdfList)
+{
+    if (!enabled || key.empty()) return nullptr;
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(getPath(key), ec)) {
+        ++missCount;
+        return nullptr;
+    }
+    auto sdf = SDF::fromFile(pDevice, getPath(key), sdfList);
+    if (!sdf) {
+        ++missCount;
+        return nullptr;
+    }
+    ++hitCount;
+    sdf->cacheKey = key;
+    return sdf;
+}
+
+bool SDFCache::store(RenderContext* pContext, const SDF& sdf)
+{
+    if (!enabled || sdf.cacheKey.empty()) return false;
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(getPath(sdf.cacheKey), ec)) return true;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        msgBox("Error", "[SDFCache::store] Couldn't create " + directory.string() + ": " + ec.message(), MsgBoxType::Ok, MsgBoxIcon::Error);
+        return false;
+    }
+    return sdf.toFile(pContext, getPath(sdf.cacheKey));
+}
+
+void SDFCache::clear()
+{
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (entry.path().extension() == ".sdf")
+            std::filesystem::remove(entry.path(), ec);
+    }
+}
+
+void SDFCache::renderGui(Gui::Widgets& w)
+{
+    w.checkbox("Use SDF cache", enabled);
+    w.tooltip("Identical generations are loaded from " + directory.string() + " instead of baked again");
+    w.text("Cache hits: " + std::to_string(hitCount) + ", misses: " + std::to_string(missCount));
+    if (w.button("Clear SDF cache", true)) {
+        clear();
+    }
+}
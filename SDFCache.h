@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SDF.h"
+
+// On-disk cache of baked SDFs, the files are SDFFiles named after the hash of the generation descriptor.
+// A generation whose key is found is loaded from the disk instead of dispatching the compute programs.
+class SDFCache {
+public:
+    static constexpr const char* kDefaultDirectory = "SDFCache";
+
+    bool enabled = true;
+    std::filesystem::path directory = kDefaultDirectory;
+    uint hitCount = 0;
+    uint missCount = 0;
+
+    // Bump when the host code of the generation changes the baked volumes, the cached files become misses.
+    // Changes of the generation shaders are detected without it, their text is hashed (kGenerationShaders).
+    static constexpr uint kGeneratorVersion = 1;
+
+    // Hash of everything that determines the baked volume: the generator (kGeneratorVersion and the text of
+    // the generation shaders), the data desc, the min. distance mips and the identity of the source (procedural
+    // function name and file text, mesh contents and bake methods, cache key of the resampled SDF).
+    // Empty if the source can't be identified, those are not cached.
+    // The files included by a procedural function file are not hashed.
+    static std::string computeKey(const SDF_Generation_Desc& genDesc);
+
+    // nullptr on a miss, the SDF is in the Postprocessing state like after SDF::fromFile
+    std::shared_ptr<SDF> load(const ref<Device>& pDevice, const std::string& key, ProceduralSDFList* sdfList);
+    // saves a complete SDF under its cacheKey, does nothing if it's already cached
+    bool store(RenderContext* pContext, const SDF& sdf);
+    // deletes the cached files
+    void clear();
+
+    void renderGui(Gui::Widgets& w);
+
+private:
+    std::filesystem::path getPath(const std::string& key) const { return directory / (key + ".sdf"); }
+};
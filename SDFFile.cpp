@@ -0,0 +1,271 @@
+#include "SDFFile.h"
+
+#include <cstring>
+#include <fstream>
+
+uint32_t getSDFFileFormatBytes(SDFFileFormat format)
+{
+    switch (format)
+    {
+    case SDFFileFormat::R8Unorm:
+        return 1;
+    case SDFFileFormat::R16Float:
+        return 2;
+    case SDFFileFormat::R32Float:
+        return 4;
+    case SDFFileFormat::RGBA16Float:
+    case SDFFileFormat::RG32Uint:
+    case SDFFileFormat::RG32Float:
+        return 8;
+    case SDFFileFormat::RGBA32Float:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+uint64_t calcSDFFilePayloadSize(const SDFFileTexture& tex)
+{
+    const uint64_t texelBytes = getSDFFileFormatBytes((SDFFileFormat)tex.format);
+    uint64_t size = 0;
+    uint3 dims{ tex.width, tex.height, tex.depth };
+    for (uint32_t mip = 0; mip < tex.mipLevels; ++mip) {
+        size += texelBytes * dims.x * dims.y * dims.z;
+        dims = max(dims / 2u, uint3(1));
+    }
+    return size;
+}
+
+namespace {
+uint64_t alignPayload(uint64_t offset)
+{
+    return (offset + kSDFFilePayloadAlignment - 1) / kSDFFilePayloadAlignment * kSDFFilePayloadAlignment;
+}
+
+void writeString(std::ostream& os, const std::string& str)
+{
+    const uint32_t length = (uint32_t)str.size();
+    os.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    os.write(str.data(), length);
+}
+
+// bounds checked reads from the mapped file
+struct Reader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+
+    bool read(void* dst, size_t n)
+    {
+        if (n > size - pos) return false;
+        std::memcpy(dst, data + pos, n);
+        pos += n;
+        return true;
+    }
+    bool readString(std::string& str)
+    {
+        uint32_t length = 0;
+        if (!read(&length, sizeof(length)) || length > size - pos) return false;
+        str.assign(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return true;
+    }
+};
+}
+
+bool SDFFile::write(const std::filesystem::path& path, const std::vector<std::vector<uint8_t>>& payloads, std::string& error)
+{
+    if (payloads.size() != textures.size()) {
+        error = "the number of payloads doesn't match the number of textures";
+        return false;
+    }
+    std::memcpy(header.magic, kSDFFileMagic, sizeof(header.magic));
+    header.version = kSDFFileVersion;
+    header.textureCount = (uint32_t)textures.size();
+
+    uint64_t offset = sizeof(SDFFileHeader)
+        + 3 * sizeof(uint32_t) + modelName.size() + proceduralName.size() + proceduralFile.size()
+        + textures.size() * sizeof(SDFFileTexture);
+    for (size_t i = 0; i < textures.size(); ++i) {
+        auto& tex = textures[i];
+        tex.byteSize = calcSDFFilePayloadSize(tex);
+        if (tex.byteSize == 0 || tex.byteSize != payloads[i].size()) {
+            error = "the payload size of texture " + std::to_string(i) + " doesn't match its description";
+            return false;
+        }
+        offset = alignPayload(offset);
+        tex.offset = offset;
+        offset += tex.byteSize;
+    }
+
+    std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+    if (!fout) {
+        error = "couldn't open " + path.string() + " for writing";
+        return false;
+    }
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeString(fout, modelName);
+    writeString(fout, proceduralName);
+    writeString(fout, proceduralFile);
+    fout.write(reinterpret_cast<const char*>(textures.data()), textures.size() * sizeof(SDFFileTexture));
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const uint64_t padding = textures[i].offset - (uint64_t)fout.tellp();
+        static const char zeros[kSDFFilePayloadAlignment] = {};
+        fout.write(zeros, padding);
+        fout.write(reinterpret_cast<const char*>(payloads[i].data()), payloads[i].size());
+    }
+    if (!fout) {
+        error = "couldn't write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+bool SDFFile::open(const std::filesystem::path& path, std::string& error)
+{
+    mpFile = std::make_unique<MemoryMappedFile>(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+    if (!mpFile->isOpen()) {
+        error = "couldn't open " + path.string();
+        mpFile.reset();
+        return false;
+    }
+    Reader reader{ static_cast<const uint8_t*>(mpFile->getData()), mpFile->getMappedSize() };
+
+    bool ok = reader.read(&header, sizeof(header));
+    if (!ok || std::memcmp(header.magic, kSDFFileMagic, sizeof(header.magic)) != 0) {
+        error = path.string() + " is not an SDF file";
+        mpFile.reset();
+        return false;
+    }
+    if (header.version < kSDFFileMinVersion || header.version > kSDFFileVersion) {
+        error = "unsupported SDF file version " + std::to_string(header.version) + ", expected " + std::to_string(kSDFFileMinVersion)
+            + " to " + std::to_string(kSDFFileVersion);
+        mpFile.reset();
+        return false;
+    }
+    ok = reader.readString(modelName) && reader.readString(proceduralName) && reader.readString(proceduralFile);
+    // the count is checked against the file before anything is allocated for it
+    ok = ok && header.textureCount <= (reader.size - reader.pos) / sizeof(SDFFileTexture);
+    if (ok) {
+        textures.resize(header.textureCount);
+        ok = reader.read(textures.data(), textures.size() * sizeof(SDFFileTexture));
+    }
+    if (!ok) {
+        error = path.string() + " is truncated";
+        mpFile.reset();
+        return false;
+    }
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const auto& tex = textures[i];
+        const bool validSize = tex.width > 0 && tex.height > 0 && tex.depth > 0 && tex.mipLevels > 0 && tex.mipLevels <= 32
+            && tex.width <= kSDFFileMaxTextureSize && tex.height <= kSDFFileMaxTextureSize && tex.depth <= kSDFFileMaxTextureSize;
+        if (!validSize || tex.role >= kSDFFileTextureRoleCount || tex.byteSize != calcSDFFilePayloadSize(tex) || tex.byteSize == 0
+            || tex.offset > reader.size || tex.byteSize > reader.size - tex.offset) {
+            error = "texture " + std::to_string(i) + " of " + path.string() + " is invalid or truncated";
+            mpFile.reset();
+            return false;
+        }
+    }
+    if (!validate(error)) {
+        error = path.string() + ": " + error;
+        mpFile.reset();
+        return false;
+    }
+    return true;
+}
+
+bool SDFFile::validate(std::string& error) const
+{
+    if (header.sdfType >= kSDFFileSdfTypeCount || header.sourceType >= kSDFFileSourceTypeCount) {
+        error = "unknown SDF type " + std::to_string(header.sdfType) + " or source type " + std::to_string(header.sourceType);
+        return false;
+    }
+    for (size_t i = 0; i < textures.size(); ++i) {
+        if (findTexture((SDFFileTextureRole)textures[i].role) != (int)i) {
+            error = "more than one texture with role " + std::to_string(textures[i].role);
+            return false;
+        }
+    }
+    if (header.sdfType == 1) // SDF_Type::Procedural, the textures are not used
+        return true;
+
+    const uint3 res{ header.resolution[0], header.resolution[1], header.resolution[2] };
+    if (any(res == 0u) || any(res > kSDFFileMaxTextureSize)) {
+        error = "invalid resolution";
+        return false;
+    }
+    const bool brickType = header.sdfType == 2 || header.sdfType == 4; // SDF_Type::SparseBrick, QuantizedBrick
+    if (brickType && any(res % kSDFFileBrickSize != 0u)) {
+        error = "the resolution is not a multiple of the brick size " + std::to_string(kSDFFileBrickSize);
+        return false;
+    }
+    const uint3 brickGrid = res / kSDFFileBrickSize;
+
+    // the expected size (0: any multiple of a brick) and the formats of every role, per SDF type
+    struct Expected {
+        bool required;
+        uint3 size;
+        uint32_t formatMask; // 1 << SDFFileFormat
+    };
+    auto formats = [](SDFFileFormat a, SDFFileFormat b = SDFFileFormat::Unknown) {
+        return (1u << (uint32_t)a) | (b == SDFFileFormat::Unknown ? 0u : 1u << (uint32_t)b);
+    };
+    auto expect = [&](SDFFileTextureRole role) -> Expected {
+        switch (role)
+        {
+        case SDFFileTextureRole::Texture:
+            switch (header.sdfType)
+            {
+            case 0: // SDF_Type::SDF0
+                return { true, res, formats(SDFFileFormat::R16Float, SDFFileFormat::R32Float) };
+            case 2: // SDF_Type::SparseBrick, the atlas has as many bricks as were allocated
+                return { true, uint3(0), formats(SDFFileFormat::R16Float, SDFFileFormat::R32Float) };
+            case 3: // SDF_Type::SDF1
+                return { true, res, formats(SDFFileFormat::RGBA16Float, SDFFileFormat::RGBA32Float) };
+            default: // SDF_Type::QuantizedBrick
+                return { true, brickGrid * kSDFFileBrickTexels, formats(SDFFileFormat::R8Unorm) };
+            }
+        case SDFFileTextureRole::Texture2: // helper texture of mesh SDF0
+            return { false, res, formats(SDFFileFormat::RGBA16Float, SDFFileFormat::RGBA32Float) };
+        case SDFFileTextureRole::BrickIndirection:
+            return { header.sdfType == 2, brickGrid, formats(SDFFileFormat::RG32Uint) };
+        default: // SDFFileTextureRole::BrickRange
+            return { header.sdfType == 4, brickGrid, formats(SDFFileFormat::RG32Float) };
+        }
+    };
+    for (uint32_t role = 0; role < kSDFFileTextureRoleCount; ++role) {
+        const Expected e = expect((SDFFileTextureRole)role);
+        const int index = findTexture((SDFFileTextureRole)role);
+        if (index < 0) {
+            if (e.required) {
+                error = "texture with role " + std::to_string(role) + " is missing";
+                return false;
+            }
+            continue;
+        }
+        const auto& tex = textures[index];
+        const uint3 size{ tex.width, tex.height, tex.depth };
+        const bool sizeOk = any(e.size != 0u) ? all(size == e.size) : all(size % kSDFFileBrickTexels == 0u);
+        const bool formatOk = tex.format < 32 && (e.formatMask & (1u << tex.format)) != 0;
+        if (!sizeOk || !formatOk) {
+            error = "the size or format of the texture with role " + std::to_string(role) + " doesn't match the SDF type and resolution";
+            return false;
+        }
+    }
+    return true;
+}
+
+const uint8_t* SDFFile::getPayload(size_t textureIndex) const
+{
+    if (!mpFile || textureIndex >= textures.size()) return nullptr;
+    return static_cast<const uint8_t*>(mpFile->getData()) + textures[textureIndex].offset;
+}
+
+int SDFFile::findTexture(SDFFileTextureRole role) const
+{
+    for (size_t i = 0; i < textures.size(); ++i) {
+        if (textures[i].role == (uint32_t)role)
+            return (int)i;
+    }
+    return -1;
+}
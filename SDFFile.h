@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Utils/Math/Vector.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace Falcor;
+
+// Binary container of a baked SDF, see SDF::toFile and SDF::fromFile.
+// It doesn't depend on the device, so the CPU tracer can read the fields too.
+//
+// Layout (little endian):
+//   SDFFileHeader
+//   model name, procedural function name, procedural function file (uint32 length + chars each)
+//   SDFFileTexture[header.textureCount]
+//   texture payloads, each at a kSDFFilePayloadAlignment aligned offset,
+//   every mip level of a texture tightly packed after each other (x is the fastest changing coordinate)
+//
+// Bump kSDFFileVersion whenever the layout changes or a new value of SDF_Type, Source_Type, SDFFileFormat or
+// SDFFileTextureRole can be written, so older readers reject the file instead of misreading it.
+// Versions from kSDFFileMinVersion on are read, the layout didn't change since version 1.
+//   1: SDF0, procedural
+//   2: sparse brick
+//   3: SDF1
+//   4: quantized brick
+constexpr char kSDFFileMagic[8] = { 'S', 'D', 'F', 'F', 'I', 'L', 'E', '\0' };
+constexpr uint32_t kSDFFileVersion = 4;
+constexpr uint32_t kSDFFileMinVersion = 1;
+constexpr uint64_t kSDFFilePayloadAlignment = 256;
+
+// the texel formats the file can store, the values are part of the file format
+enum class SDFFileFormat : uint32_t {
+    Unknown = 0,
+    R16Float = 1,
+    R32Float = 2,
+    RGBA16Float = 3,
+    RGBA32Float = 4,
+    RG32Uint = 5,
+    R8Unorm = 6,
+    RG32Float = 7,
+};
+// 0 for Unknown
+uint32_t getSDFFileFormatBytes(SDFFileFormat format);
+
+// which texture of the SDF the payload belongs to, the values are part of the file format
+enum class SDFFileTextureRole : uint32_t {
+    Texture = 0,  // SDF::texture
+    Texture2 = 1, // SDF::texture2
+    BrickIndirection = 2, // SDF::brickIndirection
+    BrickRange = 3, // SDF::brickRange
+};
+constexpr uint32_t kSDFFileTextureRoleCount = 4;
+
+// the values of SDFFileHeader::sdfType (SDF_Type) and sourceType (Source_Type) this version knows
+constexpr uint32_t kSDFFileSdfTypeCount = 5;
+constexpr uint32_t kSDFFileSourceTypeCount = 3;
+// the brick layout of SDF_Type::SparseBrick and QuantizedBrick, see SDF::kSparseBrickSize and SDF::kQuantizedBrickSize
+constexpr uint32_t kSDFFileBrickSize = 8;     // cells per brick side
+constexpr uint32_t kSDFFileBrickTexels = 9;   // samples per brick side
+// larger textures are rejected, it also keeps the payload size computation from overflowing
+constexpr uint32_t kSDFFileMaxTextureSize = 1u << 16;
+
+struct SDFFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t textureCount;
+    // SDF_Data_Desc
+    uint32_t sdfType;           // SDF_Type
+    uint32_t halfPrecision;
+    uint32_t resolution[3];
+    float boxCorner[3];
+    float boxSize[3];
+    // SDF_Generation_Desc
+    uint32_t sourceType;        // Source_Type
+    uint32_t outputVoxelSize[3];
+    // default bounding box of the procedural function
+    float proceduralBoxCorner[3];
+    float proceduralBoxSize[3];
+};
+static_assert(std::is_trivially_copyable_v<SDFFileHeader>, "SDFFileHeader is written as raw bytes");
+
+struct SDFFileTexture {
+    uint32_t role;              // SDFFileTextureRole
+    uint32_t format;            // SDFFileFormat
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t mipLevels;
+    uint64_t offset;            // payload position from the start of the file
+    uint64_t byteSize;          // payload size of all mip levels
+};
+static_assert(std::is_trivially_copyable_v<SDFFileTexture>, "SDFFileTexture is written as raw bytes");
+
+// size of a tightly packed mip chain
+uint64_t calcSDFFilePayloadSize(const SDFFileTexture& tex);
+
+class SDFFile {
+public:
+    SDFFileHeader header{};
+    std::string modelName;
+    std::string proceduralName;
+    std::string proceduralFile;
+    std::vector<SDFFileTexture> textures;
+
+    // payloads[i] is the tightly packed mip chain of textures[i], offsets and sizes are set by the function
+    // returns false and sets `error` on failure
+    bool write(const std::filesystem::path& path, const std::vector<std::vector<uint8_t>>& payloads, std::string& error);
+
+    // memory maps the file, the payloads stay mapped until the object is destroyed or `open` is called again
+    // The header and the texture descriptions are validated: known types, formats and roles, payloads inside of
+    // the file, and texture sizes that match the resolution of the SDF type. The payload contents are not checked.
+    // returns false and sets `error` on failure
+    bool open(const std::filesystem::path& path, std::string& error);
+
+    // valid after a successful `open`
+    const uint8_t* getPayload(size_t textureIndex) const;
+    // returns the index of the texture or -1
+    int findTexture(SDFFileTextureRole role) const;
+
+private:
+    // see `open`, doesn't touch the payloads
+    bool validate(std::string& error) const;
+
+    std::unique_ptr<MemoryMappedFile> mpFile;
+};
@@ -27,12 +27,27 @@
  **************************************************************************/
 #include "SDFRenderer.h"
 
+#include <fmt/format.h>
+
 #include <chrono>
+#include <cstring>
 #include <fstream>
 
 using namespace std::literals::string_literals;
 
 namespace {
+constexpr char kGenProfilerEvent[] = "sdfGeneration";
+constexpr char kTraceProfilerEvent[] = "model";
+// by SDF_TRACE_FUN_NUM - 1
+const char* kTraceFunctionNames[] = { "Sphere", "Relaxed", "Enhanced", "Auto", "Hierarchical", "Segment", "Hinted" };
+
+// float value of a shader define, 9 significant digits round-trip every float
+// (std::to_string has a fixed 6 decimals, so small values become 0)
+std::string floatDefine(float value)
+{
+    return fmt::format("{:.9g}", value);
+}
+
 const std::filesystem::path kSDir = "Samples/SDFRenderer/Shaders";
 std::filesystem::path kProceduralSDFListFile = "";
 std::filesystem::path kCameraPositionsFile = "";
@@ -40,7 +55,13 @@ const Gui::RadioButtonGroup kCameraRadioButtons = { {0,"Orbiter", false}, {1,"FP
 
 // the size of the SDF input voxels we iterate over in one call (32^3)
 const uint3 kInputVoxelSize{32, 32, 32};
-const uint kInputMeshChunk = 8192;
+const uint kInputMeshChunk = FlatMesh::kChunkSize;
+// pixels per side of the tiles of the cone pre-pass
+const uint kConeTileSize = 8;
+// cone marching steps of the pre-pass
+const uint kConePrepassMaxStep = 64;
+// Mesh_Calc_Method::NarrowBand: the voxels within this many cells of a triangle get their exact distance
+const uint kNarrowBandCells = 1;
 }
 
 template<typename F>
@@ -83,14 +104,15 @@ void SDFRenderer::SDF_Generation_State::renderGui(Gui::Widgets& w, float* state)
     }
 }
 
-void SDFRenderer::DebugUtils::renderGui(Gui::Widgets& w)
+void SDFRenderer::DebugUtils::renderGui(Gui::Widgets& w, RenderContext* pContext, AsyncCapture& capture)
 {
     static bool showMsg = false;
-    if (doSaveDepthToTexture || doCountConvergence) {
+    if (doSaveDepthToTexture || doCountConvergence || doCountConvergenceHistogram) {
         // the user requested the calculation but it was not done
         showMsg = true;
         doSaveDepthToTexture = false;
         doCountConvergence = false;
+        doCountConvergenceHistogram = false;
     }
     if(showMsg){
         w.text("Set ENABLE_DEBUG_UTILS to use the debug features");
@@ -109,7 +131,7 @@ void SDFRenderer::DebugUtils::renderGui(Gui::Widgets& w)
         filters.push_back({ "exr", "EXR Files" });
         std::filesystem::path path = "depth.exr";
         if (saveFileDialog(filters, path)) {
-            debugTexture->captureToFile(0, 0, path, Bitmap::FileFormat::ExrFile);
+            capture.capture(pContext, debugTexture, path, Bitmap::FileFormat::ExrFile);
         }
     }
 }
@@ -181,6 +203,7 @@ void SDFRenderer::onGuiRender(Gui* pGui)
     w.text("=== Screen capture (press C) ===");
     ImGui::PopStyleColor();
     mScreenCapture.renderGui(w);
+    mAsyncCapture.renderGui(w);
     w.separator();
 
     GuiGroup(w, "Camera Controls", false, [&](auto&& g) {
@@ -227,6 +250,7 @@ void SDFRenderer::ProgramState::RenderGUI(const ref<Device>& pDevice, SDFRendere
             mDoGenerateSDF = true;
         }
         ImGui::PopStyleColor();
+        app.mSDFCache.renderGui(g);
         static auto endTime = std::chrono::high_resolution_clock::now();
         auto elapsedGenTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - mGenStartTime);
         auto elapsedSeconds = elapsedGenTime.count() / 1000.0f;
@@ -252,8 +276,11 @@ void SDFRenderer::ProgramState::RenderGUI(const ref<Device>& pDevice, SDFRendere
                 mGenState.inputDispatchIndex = 0;
                 mGenState.outputDispatchIndex = 0;
                 mDoMakeTraceProgram = false;
-                mpSDF.reset();
+                // go back to the previous SDF
+                mpSDF = std::move(mpPreviousSDF);
+                mpActiveTraceProg = std::move(mpPreviousTraceProg);
             }
+            mGenScheduler.renderGui(w2);
         }
         ImGui::Text("Generation time: %.2f s", elapsedSeconds);
         });
@@ -265,13 +292,38 @@ void SDFRenderer::ProgramState::RenderGUI(const ref<Device>& pDevice, SDFRendere
             mDoMakeTraceProgram = true;
         }
         ImGui::PopStyleColor();
+        g.text("Cached programs: " + std::to_string(app.mTraceProgramCache.size()) + " / " + std::to_string(app.mTraceProgramCache.capacity()));
+        if (g.button("Clear", true)) {
+            app.mTraceProgramCache.clear();
+        }
         });
 
     GuiGroup(w, "Active SDF", false, [&](auto&& g) {
+        if (g.button("Load SDF file...")) {
+            FileDialogFilterVec filters;
+            filters.push_back({ "sdf", "SDF Files" });
+            std::filesystem::path path;
+            if (openFileDialog(filters, path)) {
+                if (auto pSDF = SDF::fromFile(pDevice, path, &app.mProceduralSDFList)) {
+                    mpSDF = std::move(pSDF);
+                    mTraceProgramSettings.type = mpSDF->desc.type;
+                    mTraceProgramSettings.proceduralSDFDesc = mpSDF->programDesc.proceduralSDFDesc;
+                    mDoMakeTraceProgram = true;
+                }
+            }
+        }
         if (!mpSDF) {
             g.text("No sdf is loaded");
         }
         else {
+            if (g.button("Save SDF file...", true)) {
+                FileDialogFilterVec filters;
+                filters.push_back({ "sdf", "SDF Files" });
+                std::filesystem::path path = mpSDF->modelName + ".sdf";
+                if (saveFileDialog(filters, path)) {
+                    mpSDF->toFile(pDevice->getRenderContext(), path);
+                }
+            }
             ImGui::PushID(mpSDF.get());
             mpSDF->renderGui(g);
             ImGui::PopID();
@@ -282,7 +334,7 @@ void SDFRenderer::ProgramState::RenderGUI(const ref<Device>& pDevice, SDFRendere
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 1, 0, 1));
         g.text("=== Convergence test, Depth to texture ===");
         ImGui::PopStyleColor();
-        mDebug.renderGui(g);
+        mDebug.renderGui(g, pDevice->getRenderContext(), app.mAsyncCapture);
         g.separator();
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 1, 0, 1));
         g.text("=== Automatic convergence test ===");
@@ -292,11 +344,15 @@ void SDFRenderer::ProgramState::RenderGUI(const ref<Device>& pDevice, SDFRendere
         g.text("=== Automatic performance test ===");
         ImGui::PopStyleColor();
         app.mPerfTester.renderGui(g);
+        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 1, 0, 1));
+        g.text("=== Camera path flythrough ===");
+        ImGui::PopStyleColor();
+        app.mFlythrough.renderGui(g, pDevice->getRenderContext());
         });
     w.separator();
 }
 
-ref<ComputeProgramWrapper> SDFRenderer::createGenProgram(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc)
+ref<ComputeProgramWrapper> SDFRenderer::createGenProgram(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, const std::string& entryOverride)
 {
     // create SDF gen. program
     DefineList defList = {};
@@ -324,7 +380,7 @@ ref<ComputeProgramWrapper> SDFRenderer::createGenProgram(const ref<Device>& pDev
             defList.emplace("PROCEDURAL_FUNCTION_FILE", "\"" + genDesc.sourceDesc.proceduralFunction->file + "\"");
         }
         else {
-            defList.emplace("SDF_SOURCE", "1");
+            defList.emplace("SDF_SOURCE", getSdfSourceDefine(genDesc.sourceDesc.sdfToResample->desc.type.sdfType));
         }
         break;
     case Source_Type::MeshCalc:
@@ -334,8 +390,31 @@ ref<ComputeProgramWrapper> SDFRenderer::createGenProgram(const ref<Device>& pDev
         return nullptr;
     }
     defList.emplace("MESH_CHUNK_SIZE", std::to_string(kInputMeshChunk));
-    const char* entry = genDesc.sourceDesc.sourceType == Source_Type::MeshCalc ? "calcMesh_main" : "main";
+    const bool meshBVH = genDesc.sourceDesc.sourceType == Source_Type::MeshCalc && genDesc.sourceDesc.meshCalcMethod == Mesh_Calc_Method::BVH;
+    if (genDesc.sourceDesc.needsMeshBVH()) {
+        defList.emplace("MESH_BVH_MAX_DEPTH", std::to_string(FlatMesh::kMaxBVHDepth));
+    }
+    if (genDesc.sourceDesc.sourceType == Source_Type::MeshCalc && genDesc.sourceDesc.meshSignMethod == Mesh_Sign_Method::WindingNumber) {
+        defList.emplace("MESH_SIGN_WINDING", "1");
+    }
+    const char* entry = genDesc.sourceDesc.sourceType == Source_Type::MeshCalc ? (meshBVH ? "calcMeshBVH_main" : "calcMesh_main") : "main";
     const char* mainFile = genDesc.sourceDesc.sourceType == Source_Type::MeshCalc ? "computeFromMesh.cs.slang" : "computeSDF.cs.slang";
+    if (genDesc.sourceDesc.sourceType == Source_Type::MeshCalc && genDesc.sourceDesc.meshCalcMethod == Mesh_Calc_Method::NarrowBand) {
+        mainFile = "computeNarrowBand.cs.slang";
+        entry = "resolve_main";
+    }
+    if (!entryOverride.empty()) {
+        entry = entryOverride.c_str();
+    }
+    if (genDesc.dataDesc.type.sdfType == SDF_Type::SparseBrick) {
+        mainFile = "computeSparseBrick.cs.slang";
+    }
+    if (genDesc.dataDesc.type.sdfType == SDF_Type::QuantizedBrick) {
+        mainFile = "computeQuantizedBrick.cs.slang";
+    }
+    if (genDesc.dataDesc.type.sdfType == SDF_Type::SDF1 && genDesc.sourceDesc.sourceType != Source_Type::MeshCalc) {
+        defList.emplace("OUTPUT_GRADIENT", "1");
+    }
 
     auto genProg = ComputeProgramWrapper::create(pDevice);
     genProg->createProgram(kSDir / mainFile, entry, defList);
@@ -353,9 +432,13 @@ ref<GraphicsProgramWrapper> SDFRenderer::createTraceProgram(const ref<Device>& p
     case SDF_Type::Procedural:
         defList.emplace("SDF_SOURCE", "0");
         defList.emplace("PROCEDURAL_FUNCTION_FILE", "\"" + traceDesc.proceduralSDFDesc.file + "\"");
+        defList.emplace("PROCEDURAL_LIPSCHITZ", floatDefine(traceDesc.proceduralSDFDesc.lipschitz));
         break;
     case SDF_Type::SDF0:
-        defList.emplace("SDF_SOURCE", "1");
+    case SDF_Type::SparseBrick:
+    case SDF_Type::SDF1:
+    case SDF_Type::QuantizedBrick:
+        defList.emplace("SDF_SOURCE", getSdfSourceDefine(sdfType.sdfType));
         break;
     default:
         msgBox("Error", "[SDFRenderer::createTraceProgram] Unsupported SDF_Type", MsgBoxType::Ok, MsgBoxIcon::Error);
@@ -364,7 +447,10 @@ ref<GraphicsProgramWrapper> SDFRenderer::createTraceProgram(const ref<Device>& p
     if (traceDesc.screenspaceNormal) {
         defList.emplace("SCREENSPACE_NORMAL", "1");
     }
-    if (traceDesc.FORWARD_DIFF_NORMAL && !traceDesc.screenspaceNormal) {
+    if (traceDesc.ANALYTIC_NORMAL && !traceDesc.screenspaceNormal) {
+        defList.emplace("ANALYTIC_NORMAL", "1");
+    }
+    else if (traceDesc.FORWARD_DIFF_NORMAL && !traceDesc.screenspaceNormal) {
         defList.emplace("FORWARD_DIFF_NORMAL", "1");
     }
     if (traceDesc.CALC_HARD_SHADOW) {
@@ -380,6 +466,13 @@ ref<GraphicsProgramWrapper> SDFRenderer::createTraceProgram(const ref<Device>& p
         defList.emplace("ENABLE_DEBUG_UTILS", "1");
         defList.emplace("DEBUG_COLORING", std::to_string(traceDesc.DEBUG_COLORING));
     }
+    if (traceDesc.CONE_PREPASS) {
+        defList.emplace("CONE_PREPASS", "1");
+        defList.emplace("CONE_TILE_SIZE", std::to_string(kConeTileSize));
+    }
+    if (traceDesc.TEMPORAL_REPROJECTION) {
+        defList.emplace("TEMPORAL_REPROJECTION", "1");
+    }
     defList.emplace("SDF_TRACE_FUN_NUM", std::to_string(traceDesc.SDF_TRACE_FUN_NUM));
 
     auto prog = GraphicsProgramWrapper::create(pDevice);
@@ -389,9 +482,53 @@ ref<GraphicsProgramWrapper> SDFRenderer::createTraceProgram(const ref<Device>& p
     return prog;
 }
 
+ref<ComputeProgramWrapper> SDFRenderer::createConePrepassProgram(const ref<Device>& pDevice, const SDF_TraceProgram_Desc& traceDesc)
+{
+    const auto& sdfType = traceDesc.type;
+    DefineList defList = {};
+    switch (sdfType.sdfType)
+    {
+    case SDF_Type::Procedural:
+        defList.emplace("SDF_SOURCE", "0");
+        defList.emplace("PROCEDURAL_FUNCTION_FILE", "\"" + traceDesc.proceduralSDFDesc.file + "\"");
+        break;
+    case SDF_Type::SDF0:
+    case SDF_Type::SparseBrick:
+    case SDF_Type::SDF1:
+    case SDF_Type::QuantizedBrick:
+        defList.emplace("SDF_SOURCE", getSdfSourceDefine(sdfType.sdfType));
+        break;
+    default:
+        msgBox("Error", "[SDFRenderer::createConePrepassProgram] Unsupported SDF_Type", MsgBoxType::Ok, MsgBoxIcon::Error);
+        return nullptr;
+    }
+    defList.emplace("CONE_TILE_SIZE", std::to_string(kConeTileSize));
+
+    auto prog = ComputeProgramWrapper::create(pDevice);
+    prog->createProgram(kSDir / "conePrepass.cs.slang", "conePrepass_main", defList);
+    return prog;
+}
+
+ComputeProgramWrapper* SDFRenderer::getConePrepassProgram(const SDF_TraceProgram_Desc& traceDesc)
+{
+    if (auto pCached = mConePrepassCache.find(traceDesc))
+        return pCached->get();
+    auto pProg = createConePrepassProgram(mpDevice, traceDesc);
+    if (!pProg)
+        return nullptr;
+    return mConePrepassCache.insert(traceDesc, pProg).get();
+}
+
 void SDFRenderer::setActiveTraceProgram(const SDF_TraceProgram_Desc& traceDesc)
 {
-    state().mpActiveTraceProg = createTraceProgram(mpDevice, traceDesc);
+    if (auto pCached = mTraceProgramCache.find(traceDesc)) {
+        state().mpActiveTraceProg = *pCached;
+    }
+    else {
+        state().mpActiveTraceProg = createTraceProgram(mpDevice, traceDesc);
+        if (state().mpActiveTraceProg)
+            mTraceProgramCache.insert(traceDesc, state().mpActiveTraceProg);
+    }
     if(state().mpSDF)
         state().mpSDF->programDesc = traceDesc;
 }
@@ -429,9 +566,30 @@ std::shared_ptr<SDF> SDFRenderer::ProgramState::generateSDF(
             return {};
         }
     }
+    if (dest.type.sdfType == SDF_Type::SparseBrick) {
+        if (source.sourceType == Source_Type::MeshCalc) {
+            msgBox("Error", "[SDFRenderer::generateSDF] Mesh input is unsupported for SparseBrick, generate an SDF0 from the mesh and resample it", MsgBoxType::Ok, MsgBoxIcon::Error);
+            return {};
+        }
+        if (any(res % SDF::kSparseBrickSize != 0u) || any(res / SDF::kSparseBrickSize > 1024u)) {
+            msgBox("Error", "[SDFRenderer::generateSDF] The resolution of a SparseBrick SDF has to be a multiple of 8 (at most 8192)", MsgBoxType::Ok, MsgBoxIcon::Error);
+            return {};
+        }
+    }
+    else if (dest.type.sdfType == SDF_Type::QuantizedBrick) {
+        if (source.sourceType == Source_Type::MeshCalc) {
+            msgBox("Error", "[SDFRenderer::generateSDF] Mesh input is unsupported for QuantizedBrick, generate an SDF0 from the mesh and resample it", MsgBoxType::Ok, MsgBoxIcon::Error);
+            return {};
+        }
+        // the atlas is the brick grid with the aprons
+        if (any(res % SDF::kQuantizedBrickSize != 0u) || any(res / SDF::kQuantizedBrickSize * SDF::kQuantizedBrickTexels > 2048u)) {
+            msgBox("Error", "[SDFRenderer::generateSDF] The resolution of a QuantizedBrick SDF has to be a multiple of 8 (at most 1816)", MsgBoxType::Ok, MsgBoxIcon::Error);
+            return {};
+        }
+    }
     else if (source.sourceType == Source_Type::MeshCalc) {
         auto t = dest.type.sdfType;
-        if (t != SDF_Type::SDF0) {
+        if (t != SDF_Type::SDF0 && t != SDF_Type::SDF1) {
             msgBox("Error", "[SDFRenderer::generateSDF] Mesh input is unsupported for this SDF type", MsgBoxType::Ok, MsgBoxIcon::Error);
             return {};
         }
@@ -439,18 +597,37 @@ std::shared_ptr<SDF> SDFRenderer::ProgramState::generateSDF(
             msgBox("Error", "[SDFRenderer::generateSDF] Empty source mesh", MsgBoxType::Ok, MsgBoxIcon::Error);
             return {};
         }
+        if (source.needsMeshBVH() && !source.mesh.bvhBuffer) {
+            msgBox("Error", "[SDFRenderer::generateSDF] The BVH of the source mesh is not built", MsgBoxType::Ok, MsgBoxIcon::Error);
+            return {};
+        }
     }
     
     switch (dest.type.sdfType)
     {
     case SDF_Type::SDF0:
+    case SDF_Type::SparseBrick:
+    case SDF_Type::SDF1:
+    case SDF_Type::QuantizedBrick:
         break;
     default:
         msgBox("Error", "[SDFRenderer::generateSDF] Unsupported SDF_Type", MsgBoxType::Ok, MsgBoxIcon::Error);
         return {};
     }
 
+    // an identical generation is loaded from the disk
+    const std::string cacheKey = app.mSDFCache.enabled ? SDFCache::computeKey(genDesc) : "";
+    if (auto cached = app.mSDFCache.load(pDevice, cacheKey, &app.mProceduralSDFList)) {
+        mDoMakeTraceProgram = true;
+        cached->genDesc = genDesc;
+        cached->genDesc.sourceDesc.mesh.reset();
+        cached->genDesc.sourceDesc.sdfToResample.reset();
+        return cached;
+    }
+
     auto sdf = std::make_shared<SDF>(dest, "", nullptr, mTraceProgramSettings);
+    sdf->cacheKey = cacheKey;
+    sdf->lipschitzFixPending = dest.type.sdfType == SDF_Type::SDF0 && genDesc.lipschitzFix != Lipschitz_Fix::None;
     sdf->modelName = [&] {
         switch (source.sourceType)
         {
@@ -467,8 +644,25 @@ std::shared_ptr<SDF> SDFRenderer::ProgramState::generateSDF(
     if (sdf->modelName.empty()) {
         msgBox("Error", "[SDFRenderer::generateSDF] Couldn't set the model name", MsgBoxType::Ok, MsgBoxIcon::Warning);
     }
-    const ResourceFormat texFormat = dest.halfPrecision ? ResourceFormat::R16Float : ResourceFormat::R32Float;
-    const uint32_t mipLevels = 1u;
+    if (dest.type.sdfType == SDF_Type::SparseBrick || dest.type.sdfType == SDF_Type::QuantizedBrick) {
+        const bool generated = dest.type.sdfType == SDF_Type::SparseBrick
+            ? generateSparseBrickSDF(pDevice, genDesc, *sdf)
+            : generateQuantizedBrickSDF(pDevice, genDesc, *sdf);
+        if (!generated) {
+            return {};
+        }
+        mDoMakeTraceProgram = true;
+        sdf->sdfState = SDF_State::Postprocessing;
+        sdf->genDesc = genDesc;
+        sdf->genDesc.sourceDesc.mesh.reset();
+        sdf->genDesc.sourceDesc.sdfToResample.reset();
+        return sdf;
+    }
+    // SDF1: distance and gradient
+    const bool hermite = dest.type.sdfType == SDF_Type::SDF1;
+    const ResourceFormat texFormat = hermite ? (dest.halfPrecision ? ResourceFormat::RGBA16Float : ResourceFormat::RGBA32Float)
+                                             : (dest.halfPrecision ? ResourceFormat::R16Float : ResourceFormat::R32Float);
+    const uint32_t mipLevels = genDesc.minDistanceMips && !hermite ? Resource::kMaxPossible : 1u;
     sdf->texture = pDevice->createTexture3D(res.x, res.y, res.z, texFormat, mipLevels, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);    
 
     if (source.sourceType == Source_Type::MeshCalc)
@@ -494,16 +688,34 @@ std::shared_ptr<SDF> SDFRenderer::ProgramState::generateSDF(
         return {};
     }
 
-    if (source.sourceType != Source_Type::MeshCalc) {
+    if (source.sourceType == Source_Type::MeshCalc && source.meshCalcMethod == Mesh_Calc_Method::NarrowBand) {
+        if (!generateNarrowBandMeshSDF(pDevice, genDesc, *sdf)) {
+            return {};
+        }
+        // no frame-distributed part, PostProcess computes the sign right away
+        mIteratedDispatchParams.genDesc = genDesc;
+        mIteratedDispatchParams.mipLevel = 0;
+        mIteratedDispatchParams.outputRes = res;
+        mDoMakeTraceProgram = true;
+        sdf->sdfState = SDF_State::Finished_Iteration;
+    }
+    else if (source.sourceType != Source_Type::MeshCalc) {
         mDoMakeTraceProgram = app.runGenProgram(
             pContext, *mpLastGenProg, sdf->texture->getUAV(0), nullptr, res, genDesc);
+        buildMinDistanceMips(pDevice, *sdf);
         sdf->sdfState = SDF_State::Postprocessing;
     } else {
         // Setup the logistics for the frame-distributed generation
         mIteratedDispatchParams.genDesc = genDesc;
         mIteratedDispatchParams.mipLevel = 0;
         mIteratedDispatchParams.outputRes = res;
-        mGenState = SDFRenderer::SDF_Generation_State::create(mGenSettings.outputVoxelSize, mIteratedDispatchParams.outputRes, kInputMeshChunk, source.mesh.numTriangles);
+        if (source.meshCalcMethod == Mesh_Calc_Method::BVH) {
+            // the BVH traversal covers every triangle, only the output is distributed over the frames
+            mGenState = SDFRenderer::SDF_Generation_State::create(mGenSettings.outputVoxelSize, mIteratedDispatchParams.outputRes, 1u, 1u);
+        }
+        else {
+            mGenState = SDFRenderer::SDF_Generation_State::create(mGenSettings.outputVoxelSize, mIteratedDispatchParams.outputRes, kInputMeshChunk, source.mesh.numTriangles);
+        }
         mGenStartTime = std::chrono::high_resolution_clock::now();
         sdf->sdfState = SDF_State::Generating;
     }
@@ -514,6 +726,196 @@ std::shared_ptr<SDF> SDFRenderer::ProgramState::generateSDF(
     return sdf;
 }
 
+bool SDFRenderer::ProgramState::generateSparseBrickSDF(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, SDF& sdf)
+{
+    const auto& dest = genDesc.dataDesc;
+    const uint3 res = dest.resolution;
+    const uint3 brickGrid = res / SDF::kSparseBrickSize;
+    const uint maxBrickCount = brickGrid.x * brickGrid.y * brickGrid.z;
+
+    auto setCommonParameters = [&](ComputeProgramWrapper& comp) {
+        comp["CScb"]["maxSize"] = res;
+        comp["CScb"]["oneOverMaxSize"] = 1.0f / float3(res);
+        comp["CScb"]["BBcorner"] = dest.box.corner;
+        comp["CScb"]["BBsize"] = dest.box.size;
+        comp["CScb"]["outBrickGridSize"] = brickGrid;
+        comp["CScb"]["maxBrickCount"] = maxBrickCount;
+        return setGenSourceParameters(comp, genDesc);
+    };
+
+    // 1. classify the bricks and allocate the ones near the surface
+    sdf.brickIndirection = pDevice->createTexture3D(brickGrid.x, brickGrid.y, brickGrid.z, ResourceFormat::RG32Uint, 1, nullptr,
+        ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    const uint zero = 0;
+    auto pCounter = pDevice->createStructuredBuffer(sizeof(uint), 1, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, MemoryType::DeviceLocal, &zero, false);
+    auto pBrickList = pDevice->createStructuredBuffer(sizeof(uint), maxBrickCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, MemoryType::DeviceLocal, nullptr, false);
+
+    auto pClassifyProg = createGenProgram(pDevice, genDesc, "classifyBricks_main");
+    if (!pClassifyProg) {
+        msgBox("Error", "[SDFRenderer::generateSparseBrickSDF] Couldn't create the classification program", MsgBoxType::Ok, MsgBoxIcon::Error);
+        return false;
+    }
+    auto& classifyProg = *pClassifyProg;
+    if (!setCommonParameters(classifyProg))
+        return false;
+    classifyProg["outIndirection"].setUav(sdf.brickIndirection->getUAV(0));
+    classifyProg["brickCounter"] = pCounter;
+    classifyProg["brickList"] = pBrickList;
+    classifyProg.runProgram(brickGrid);
+
+    // the atlas is allocated for the actual brick count (one readback)
+    const uint brickCount = std::min(pCounter->getElement<uint>(0), maxBrickCount);
+    sdf.sparseBrickCount = brickCount;
+    const uint kMaxAtlasBricks = 2048 / SDF::kSparseBrickTexels; // 3D texture size limit
+    uint atlasSide = std::max(1u, (uint)std::ceil(std::cbrt((double)brickCount)));
+    atlasSide = std::min(atlasSide, kMaxAtlasBricks);
+    const uint3 atlasCount = uint3(atlasSide, atlasSide, std::max(1u, div_round_up(brickCount, atlasSide * atlasSide)));
+    if (atlasCount.z > kMaxAtlasBricks) {
+        msgBox("Error", "[SDFRenderer::generateSparseBrickSDF] Too many bricks for the atlas: " + std::to_string(brickCount), MsgBoxType::Ok, MsgBoxIcon::Error);
+        return false;
+    }
+    const uint3 atlasSize = atlasCount * SDF::kSparseBrickTexels;
+    const ResourceFormat texFormat = dest.halfPrecision ? ResourceFormat::R16Float : ResourceFormat::R32Float;
+    sdf.texture = pDevice->createTexture3D(atlasSize.x, atlasSize.y, atlasSize.z, texFormat, 1, nullptr,
+        ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    if (brickCount == 0)
+        return true;
+
+    // 2. evaluate the samples of the allocated bricks
+    auto pFillProg = createGenProgram(pDevice, genDesc, "fillBricks_main");
+    if (!pFillProg) {
+        msgBox("Error", "[SDFRenderer::generateSparseBrickSDF] Couldn't create the fill program", MsgBoxType::Ok, MsgBoxIcon::Error);
+        return false;
+    }
+    auto& fillProg = *pFillProg;
+    if (!setCommonParameters(fillProg))
+        return false;
+    const uint dispatchWidth = std::min(brickCount, 65535u);
+    fillProg["CScb"]["outBrickAtlasCount"] = atlasCount;
+    fillProg["CScb"]["brickDispatchWidth"] = dispatchWidth;
+    fillProg["outSDF"].setUav(sdf.texture->getUAV(0));
+    fillProg["brickCounter"] = pCounter;
+    fillProg["brickList"] = pBrickList;
+    const uint texelCount = SDF::kSparseBrickTexels * SDF::kSparseBrickTexels * SDF::kSparseBrickTexels;
+    fillProg.runProgram(uint3(texelCount, dispatchWidth, div_round_up(brickCount, dispatchWidth)));
+    return true;
+}
+
+bool SDFRenderer::ProgramState::generateQuantizedBrickSDF(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, SDF& sdf)
+{
+    const auto& dest = genDesc.dataDesc;
+    const uint3 res = dest.resolution;
+    const uint3 brickGrid = res / SDF::kQuantizedBrickSize;
+    const uint3 atlasSize = brickGrid * SDF::kQuantizedBrickTexels;
+
+    sdf.texture = pDevice->createTexture3D(atlasSize.x, atlasSize.y, atlasSize.z, ResourceFormat::R8Unorm, 1, nullptr,
+        ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    sdf.brickRange = pDevice->createTexture3D(brickGrid.x, brickGrid.y, brickGrid.z, ResourceFormat::RG32Float, 1, nullptr,
+        ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+
+    auto pQuantizeProg = createGenProgram(pDevice, genDesc, "quantizeBricks_main");
+    if (!pQuantizeProg) {
+        msgBox("Error", "[SDFRenderer::generateQuantizedBrickSDF] Couldn't create the quantization program", MsgBoxType::Ok, MsgBoxIcon::Error);
+        return false;
+    }
+    auto& prog = *pQuantizeProg;
+    prog["CScb"]["maxSize"] = res;
+    prog["CScb"]["oneOverMaxSize"] = 1.0f / float3(res);
+    prog["CScb"]["BBcorner"] = dest.box.corner;
+    prog["CScb"]["BBsize"] = dest.box.size;
+    prog["CScb"]["outBrickGridSize"] = brickGrid;
+    prog["CScb"]["bandCells"] = genDesc.quantizedBandCells;
+    if (!setGenSourceParameters(prog, genDesc))
+        return false;
+    prog["outSDF"].setUav(sdf.texture->getUAV(0));
+    prog["outBrickRange"].setUav(sdf.brickRange->getUAV(0));
+    // one group per brick
+    const uint texelCount = SDF::kQuantizedBrickTexels * SDF::kQuantizedBrickTexels * SDF::kQuantizedBrickTexels;
+    prog.runProgram(uint3(brickGrid.x * texelCount, brickGrid.y, brickGrid.z));
+    return true;
+}
+
+bool SDFRenderer::ProgramState::generateNarrowBandMeshSDF(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, SDF& sdf)
+{
+    const auto& dest = genDesc.dataDesc;
+    const uint3 res = dest.resolution;
+    const uint triangleCount = genDesc.sourceDesc.mesh.numTriangles;
+
+    auto createTex = [&] {
+        return pDevice->createTexture3D(res.x, res.y, res.z, ResourceFormat::R32Uint, 1, nullptr,
+            ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    };
+    auto pSeedDistance = createTex();
+    ref<Texture> pTriangles[2] = { createTex(), createTex() };
+
+    auto createPass = [&](const std::string& entry) -> ref<ComputeProgramWrapper> {
+        auto pProg = createGenProgram(pDevice, genDesc, entry);
+        if (!pProg) {
+            msgBox("Error", "[SDFRenderer::generateNarrowBandMeshSDF] Couldn't create the " + entry + " program", MsgBoxType::Ok, MsgBoxIcon::Error);
+            return nullptr;
+        }
+        auto& prog = *pProg;
+        prog["CScb"]["maxSize"] = res;
+        prog["CScb"]["oneOverMaxSize"] = 1.0f / float3(res);
+        prog["CScb"]["BBcorner"] = dest.box.corner;
+        prog["CScb"]["BBsize"] = dest.box.size;
+        prog["CScb"]["bandCells"] = kNarrowBandCells;
+        if (!setGenSourceParameters(prog, genDesc))
+            return nullptr;
+        return pProg;
+    };
+
+    // 1. seed the voxels near the triangles with their closest triangle
+    auto pClear = createPass("clear_main");
+    auto pSeedDist = createPass("seedDistance_main");
+    auto pSeedTri = createPass("seedTriangle_main");
+    if (!pClear || !pSeedDist || !pSeedTri)
+        return false;
+    (*pClear)["seedDistance"].setUav(pSeedDistance->getUAV(0));
+    (*pClear)["seedTriangle"].setUav(pTriangles[0]->getUAV(0));
+    pClear->runProgram(res);
+
+    // one thread per triangle, in rows of 64k
+    const uint dispatchWidth = std::min(triangleCount, 65536u);
+    const uint3 triangleThreads = uint3(dispatchWidth, div_round_up(triangleCount, dispatchWidth), 1);
+    for (auto* pSeed : { pSeedDist.get(), pSeedTri.get() }) {
+        auto& seed = *pSeed;
+        seed["CScb"]["triangleCount"] = triangleCount;
+        seed["CScb"]["triangleDispatchWidth"] = dispatchWidth;
+        seed["seedDistance"].setUav(pSeedDistance->getUAV(0));
+        seed["seedTriangle"].setUav(pTriangles[0]->getUAV(0));
+        seed.runProgram(triangleThreads);
+    }
+
+    // 2. jump flooding with halving steps and an extra step of 1 (JFA+1) to fix most of its errors
+    auto pFlood = createPass("jumpFlood_main");
+    if (!pFlood)
+        return false;
+    auto& flood = *pFlood;
+    uint src = 0;
+    const uint maxRes = std::max(res.x, std::max(res.y, res.z));
+    std::vector<int> steps;
+    for (uint step = 1; step < maxRes; step *= 2)
+        steps.insert(steps.begin(), (int)step);
+    steps.push_back(1);
+    for (int step : steps) {
+        flood["CScb"]["jumpStep"] = step;
+        flood["srcTriangle"].setSrv(pTriangles[src]->getSRV());
+        flood["dstTriangle"].setUav(pTriangles[1 - src]->getUAV(0));
+        flood.runProgram(res);
+        src = 1 - src;
+    }
+
+    // 3. distance to the closest triangle and the ray parity as MeshCalcData
+    auto pResolve = createPass("resolve_main");
+    if (!pResolve)
+        return false;
+    (*pResolve)["srcTriangle"].setSrv(pTriangles[src]->getSRV());
+    (*pResolve)["outSDF"].setUav(sdf.texture2->getUAV(0));
+    pResolve->runProgram(res);
+    return true;
+}
+
 std::shared_ptr<CameraController> SDFRenderer::createCameraController(uint32_t camIndex, const ref<Camera>& pCam, const BBox& box)
 {
     switch(camIndex){
@@ -565,7 +967,10 @@ std::string SDFRenderer::ProgramState::getModelAndSettingsString()
             case 3:
                 return mRendSettings.enhancedParam;
             case 4:
+            case 7:
                 return mRendSettings.autoParam;
+            case 6:
+                return mRendSettings.segmentParam;
             default:
                 return -1.f;
             }
@@ -581,6 +986,33 @@ std::string SDFRenderer::ProgramState::getModelAndSettingsString()
     return ss.str();
 }
 
+void SDFRenderer::GenerationScheduler::update(float gpuTimeMs)
+{
+    // the reported time belongs to the frame kGpuTimeLatency frames ago, before the reset it's of an older generation
+    if (frameIndex < kGpuTimeLatency || gpuTimeMs <= 0.f) return;
+    const uint measuredCount = dispatchCounts[(frameIndex - kGpuTimeLatency) % dispatchCounts.size()];
+    if (measuredCount == 0) return;
+    const float cost = gpuTimeMs / measuredCount;
+    dispatchCostMs = dispatchCostMs == 0.f ? cost : dispatchCostMs + 0.25f * (cost - dispatchCostMs);
+    const float target = frameBudgetMs / std::max(dispatchCostMs, 1e-4f);
+    // grow at most 2x per frame
+    const float maxCount = std::min(2.f * dispatchesPerFrame, (float)maxDispatchesPerFrame);
+    dispatchesPerFrame = (uint)std::clamp(target, 1.f, maxCount);
+}
+
+void SDFRenderer::GenerationScheduler::endFrame(uint dispatchCount)
+{
+    dispatchCounts[frameIndex % dispatchCounts.size()] = dispatchCount;
+    ++frameIndex;
+}
+
+void SDFRenderer::GenerationScheduler::renderGui(Gui::Widgets& w)
+{
+    w.var("Frame budget (ms)", frameBudgetMs, 0.5f, 100.f, 0.5f);
+    w.tooltip("GPU time of the generation in a frame,\nthe rest of the frame renders the previous SDF");
+    ImGui::Text("Dispatches / frame: %u\nDispatch cost: %.3f ms", dispatchesPerFrame, dispatchCostMs);
+}
+
 bool SDFRenderer::ProgramState::GenerateFieldChunk(SDFRenderer& app, RenderContext* pContext)
 {
     static bool previousWasOn = false;
@@ -654,29 +1086,242 @@ void SDFRenderer::ProgramState::PostProcess(const ref<Device>& pDevice, SDFRende
             switch (mIteratedDispatchParams.genDesc.dataDesc.type.sdfType) {
             case SDF_Type::SDF0:
                 return "SDF_TYPE_SDF0";
+            case SDF_Type::SDF1:
+                return "SDF_TYPE_SDF1";
             default:
                 msgBox("Error", "Couldn't finish generation from mesh, the type is unsupported", MsgBoxType::Ok, MsgBoxIcon::Error);
                 return "SDF_TYPE_SDF0";
             }
         }();
-        initProg.createProgram(kSDir / "computeFromMesh.cs.slang", "finishMeshCalc_main", { { "SDF_TYPE", sdf_type} });
+        const auto& source = mIteratedDispatchParams.genDesc.sourceDesc;
+        const bool windingSign = source.meshSignMethod == Mesh_Sign_Method::WindingNumber;
+        DefineList defines{ { "SDF_TYPE", sdf_type} };
+        if (windingSign) {
+            defines.emplace("MESH_SIGN_WINDING", "1");
+            defines.emplace("MESH_BVH_MAX_DEPTH", std::to_string(FlatMesh::kMaxBVHDepth));
+            defines.emplace("MESH_WINDING_BETA", floatDefine(FlatMesh::kWindingNumberBeta));
+        }
+        initProg.createProgram(kSDir / "computeFromMesh.cs.slang", "finishMeshCalc_main", defines);
 
         initProg["tex2"].setUav(mpSDF->texture2->getUAV(0));
         initProg["outSDF"].setUav(mpSDF->texture->getUAV(0));
         initProg["CScb"]["maxSize"] = mpSDF->desc.resolution;
+        if (windingSign) {
+            // the sign is decided here with the winding number, the generation passes only computed the distance
+            initProg["triangleBuffer"] = source.mesh.buffer;
+            initProg["bvhBuffer"] = source.mesh.bvhBuffer;
+            initProg["bvhDipoleBuffer"] = source.mesh.bvhDipoleBuffer;
+            initProg["CScb"]["oneOverMaxSize"] = 1.0f / float3(mpSDF->desc.resolution);
+            initProg["CScb"]["BBcorner"] = mIteratedDispatchParams.genDesc.dataDesc.box.corner;
+            initProg["CScb"]["BBsize"] = mIteratedDispatchParams.genDesc.dataDesc.box.size;
+        }
         initProg.runProgram(mpSDF->desc.resolution);
+        if (mpSDF->desc.type.sdfType == SDF_Type::SDF1) {
+            // the signed distances are in the helper texture now, the gradients are computed from them
+            auto pGradProg = ComputeProgramWrapper::create(pDevice);
+            auto& gradProg = *pGradProg;
+            gradProg.createProgram(kSDir / "computeFromMesh.cs.slang", "meshGradient_main", defines);
+            gradProg["tex2"].setUav(mpSDF->texture2->getUAV(0));
+            gradProg["outSDF"].setUav(mpSDF->texture->getUAV(0));
+            gradProg["CScb"]["maxSize"] = mpSDF->desc.resolution;
+            gradProg["CScb"]["oneOverMaxSize"] = 1.0f / float3(mpSDF->desc.resolution);
+            gradProg["CScb"]["BBsize"] = mIteratedDispatchParams.genDesc.dataDesc.box.size;
+            gradProg.runProgram(mpSDF->desc.resolution);
+        }
+        buildMinDistanceMips(pDevice, *mpSDF);
+    }
+
+    // report the cells that break the 1-Lipschitz assumption of the tracers, and correct them for new generations
+    if (mpSDF->desc.type.sdfType == SDF_Type::SDF0 && mpSDF->texture) {
+        mpSDF->lipschitzStats = measureLipschitz(pDevice, *mpSDF);
+        mpSDF->lipschitzFixedStats = SDF_Lipschitz_Stats();
+        if (mpSDF->lipschitzFixPending && mpSDF->lipschitzStats.violatingCells() > 0) {
+            fixLipschitz(pDevice, *mpSDF, mpSDF->lipschitzStats);
+            mpSDF->lipschitzFixedStats = measureLipschitz(pDevice, *mpSDF);
+            buildMinDistanceMips(pDevice, *mpSDF);
+        }
+        mpSDF->lipschitzFixPending = false;
     }
+    // derived from the final distances, not stored in the files
+    app.buildStepHints(*mpSDF);
 
     // the generation is done, we don't need the aux texture anymore
     if (mpSDF->texture2)
         mpSDF->texture2.reset();
+    mpPreviousSDF.reset();
+    mpPreviousTraceProg.reset();
     mpSDF->sdfState = SDF_State::Complete;
+    app.mSDFCache.store(pContext, *mpSDF);
     return;
 }
 
+void SDFRenderer::buildMinDistanceMips(const ref<Device>& pDevice, const SDF& sdf)
+{
+    if (sdf.desc.type.sdfType != SDF_Type::SDF0 || !sdf.texture || sdf.texture->getMipCount() <= 1) return;
+
+    auto pProg = ComputeProgramWrapper::create(pDevice);
+    auto& prog = *pProg;
+    prog.createProgram(kSDir / "computeMinMip.cs.slang", "minMip_main", {});
+    prog["CScb"]["cellDiagonal"] = length(sdf.desc.box.size / float3(sdf.desc.resolution));
+    for (uint32_t mip = 1; mip < sdf.texture->getMipCount(); ++mip) {
+        const uint3 srcSize{ sdf.texture->getWidth(mip - 1), sdf.texture->getHeight(mip - 1), sdf.texture->getDepth(mip - 1) };
+        const uint3 dstSize{ sdf.texture->getWidth(mip), sdf.texture->getHeight(mip), sdf.texture->getDepth(mip) };
+        prog["CScb"]["srcSize"] = srcSize;
+        prog["CScb"]["dstSize"] = dstSize;
+        prog["CScb"]["isFirstLevel"] = mip == 1 ? 1u : 0u;
+        prog["srcMip"].setSrv(sdf.texture->getSRV(mip - 1, 1));
+        prog["dstMip"].setUav(sdf.texture->getUAV(mip));
+        prog.runProgram(dstSize);
+    }
+}
+
+SDF_Lipschitz_Stats SDFRenderer::measureLipschitz(const ref<Device>& pDevice, const SDF& sdf)
+{
+    SDF_Lipschitz_Stats stats;
+    if (sdf.desc.type.sdfType != SDF_Type::SDF0 || !sdf.texture) return stats;
+
+    const uint3 res = sdf.desc.resolution;
+    const uint zero[SDF_Lipschitz_Stats::kBinCount + 1] = {};
+    auto pHistogram = pDevice->createStructuredBuffer(sizeof(uint), SDF_Lipschitz_Stats::kBinCount + 1, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, MemoryType::DeviceLocal, zero, false);
+
+    auto pProg = ComputeProgramWrapper::create(pDevice);
+    auto& prog = *pProg;
+    prog.createProgram(kSDir / "computeLipschitz.cs.slang", "lipschitzMeasure_main", {});
+    prog["CScb"]["maxSize"] = res;
+    prog["CScb"]["cellSize"] = sdf.desc.box.size / float3(res);
+    prog["srcSDF"].setSrv(sdf.texture->getSRV(0, 1));
+    prog["histogram"] = pHistogram;
+    const uint3 cellCount = max(res, uint3(2)) - 1u;
+    prog.runProgram(cellCount);
+
+    const auto values = pHistogram->getElements<uint>(0, SDF_Lipschitz_Stats::kBinCount + 1);
+    for (uint i = 0; i < SDF_Lipschitz_Stats::kBinCount; ++i) {
+        stats.bins[i] = values[i];
+        stats.cellCount += values[i];
+    }
+    std::memcpy(&stats.maxGradient, &values[SDF_Lipschitz_Stats::kBinCount], sizeof(float));
+    stats.valid = true;
+    return stats;
+}
+
+void SDFRenderer::fixLipschitz(const ref<Device>& pDevice, const SDF& sdf, const SDF_Lipschitz_Stats& stats)
+{
+    const auto& genDesc = sdf.genDesc;
+    if (sdf.desc.type.sdfType != SDF_Type::SDF0 || !sdf.texture) return;
+
+    const uint3 res = sdf.desc.resolution;
+    const float3 cellSize = sdf.desc.box.size / float3(res);
+    auto pProg = ComputeProgramWrapper::create(pDevice);
+    auto& prog = *pProg;
+    switch (genDesc.lipschitzFix)
+    {
+    case Lipschitz_Fix::Rescale:
+    {
+        if (stats.maxGradient <= SDF_Lipschitz_Stats::kTolerance) return;
+        // typed UAV loads of R16Float are not guaranteed, the distances are read through an SRV into a copy
+        auto pScaled = pDevice->createTexture3D(res.x, res.y, res.z, sdf.texture->getFormat(), 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+        prog.createProgram(kSDir / "computeLipschitz.cs.slang", "lipschitzRescale_main", {});
+        prog["CScb"]["maxSize"] = res;
+        prog["CScb"]["scale"] = 1.f / stats.maxGradient;
+        prog["srcSDF"].setSrv(sdf.texture->getSRV(0, 1));
+        prog["outSDF"].setUav(pScaled->getUAV(0));
+        prog.runProgram(res);
+        pDevice->getRenderContext()->copySubresource(sdf.texture.get(), 0, pScaled.get(), 0);
+        break;
+    }
+    case Lipschitz_Fix::Reinitialize:
+    {
+        // ping-pong of the distances and the boundary flags
+        ref<Texture> pState[2];
+        for (auto& pTex : pState)
+            pTex = pDevice->createTexture3D(res.x, res.y, res.z, ResourceFormat::RG32Float, 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+
+        prog.createProgram(kSDir / "computeLipschitz.cs.slang", "lipschitzReinitInit_main", {});
+        prog["CScb"]["maxSize"] = res;
+        prog["CScb"]["cellSize"] = cellSize;
+        prog["srcSDF"].setSrv(sdf.texture->getSRV(0, 1));
+        prog["outState"].setUav(pState[0]->getUAV(0));
+        prog.runProgram(res);
+
+        auto pStepProg = ComputeProgramWrapper::create(pDevice);
+        auto& stepProg = *pStepProg;
+        stepProg.createProgram(kSDir / "computeLipschitz.cs.slang", "lipschitzReinitStep_main", {});
+        stepProg["CScb"]["maxSize"] = res;
+        stepProg["CScb"]["cellSize"] = cellSize;
+        uint current = 0;
+        for (uint i = 0; i < genDesc.lipschitzIterations; ++i) {
+            stepProg["srcState"].setSrv(pState[current]->getSRV(0, 1));
+            stepProg["outState"].setUav(pState[1 - current]->getUAV(0));
+            stepProg.runProgram(res);
+            current = 1 - current;
+        }
+
+        auto pResolveProg = ComputeProgramWrapper::create(pDevice);
+        auto& resolveProg = *pResolveProg;
+        resolveProg.createProgram(kSDir / "computeLipschitz.cs.slang", "lipschitzReinitResolve_main", {});
+        resolveProg["CScb"]["maxSize"] = res;
+        resolveProg["srcState"].setSrv(pState[current]->getSRV(0, 1));
+        resolveProg["outSDF"].setUav(sdf.texture->getUAV(0));
+        resolveProg.runProgram(res);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void SDFRenderer::buildStepHints(SDF& sdf)
+{
+    sdf.stepHint.reset();
+    DefineList defList = {};
+    uint3 grid;
+    switch (sdf.desc.type.sdfType)
+    {
+    case SDF_Type::Procedural:
+        defList.emplace("SDF_SOURCE", "0");
+        defList.emplace("PROCEDURAL_FUNCTION_FILE", "\"" + sdf.programDesc.proceduralSDFDesc.file + "\"");
+        grid = uint3(SDF::kProceduralStepHintGridSize);
+        break;
+    case SDF_Type::SDF0:
+    case SDF_Type::SparseBrick:
+    case SDF_Type::SDF1:
+    case SDF_Type::QuantizedBrick:
+        if (!sdf.texture) return;
+        defList.emplace("SDF_SOURCE", getSdfSourceDefine(sdf.desc.type.sdfType));
+        grid = div_round_up(sdf.desc.resolution, uint3(SDF::kStepHintBrickSize));
+        break;
+    default:
+        return;
+    }
+
+    ref<Texture> pHint[2];
+    for (auto& pTex : pHint)
+        pTex = mpDevice->createTexture3D(grid.x, grid.y, grid.z, ResourceFormat::RGBA16Float, 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+
+    auto pProg = ComputeProgramWrapper::create(mpDevice);
+    auto& prog = *pProg;
+    prog.createProgram(kSDir / "computeStepHint.cs.slang", "stepHint_main", defList);
+    sdf.setModelParameters(prog.getRootVar());
+    prog["sdfSampler"] = mpLinearSampler;
+    prog["CScb"]["hintGridSize"] = grid;
+    prog["outHint"].setUav(pHint[0]->getUAV(0));
+    // one group per brick
+    const uint brickSamples = (SDF::kStepHintBrickSize + 1) * (SDF::kStepHintBrickSize + 1) * (SDF::kStepHintBrickSize + 1);
+    prog.runProgram(uint3(grid.x * brickSamples, grid.y, grid.z));
+
+    auto pDilateProg = ComputeProgramWrapper::create(mpDevice);
+    auto& dilateProg = *pDilateProg;
+    dilateProg.createProgram(kSDir / "computeStepHint.cs.slang", "stepHintDilate_main", defList);
+    dilateProg["CScb"]["hintGridSize"] = grid;
+    dilateProg["srcHint"].setSrv(pHint[0]->getSRV(0, 1));
+    dilateProg["outHint"].setUav(pHint[1]->getUAV(0));
+    dilateProg.runProgram(grid);
+
+    sdf.stepHint = pHint[1];
+}
+
 bool SDFRenderer::runGenProgram(RenderContext* pContext, ComputeProgramWrapper& comp, const ref<UnorderedAccessView> destTexture, const ref<UnorderedAccessView> auxTexture, uint3 res, const SDF_Generation_Desc& genDesc) {
     const auto& dest = genDesc.dataDesc; // description of the new SDF
-    const auto& source = genDesc.sourceDesc; // description of the source SDF
 
     comp["outSDF"].setUav(destTexture);
     {
@@ -713,6 +1358,19 @@ bool SDFRenderer::runGenProgram(RenderContext* pContext, ComputeProgramWrapper&
     comp[ "CScb" ][ "currentInputOffset" ] = inputOffset;
     comp[ "CScb" ][ "currentOutputOffset" ] = ouputOffset;
 
+    if (!setGenSourceParameters(comp, genDesc))
+        return false;
+
+    comp.runProgram(dispatchRes);
+
+    return true;
+}
+
+bool SDFRenderer::setGenSourceParameters(ComputeProgramWrapper& comp, const SDF_Generation_Desc& genDesc)
+{
+    const auto& dest = genDesc.dataDesc; // description of the new SDF
+    const auto& source = genDesc.sourceDesc; // description of the source SDF
+
     switch (source.sourceType) {
     case Source_Type::ProceduralFunction:
         comp["MODELcb"]["innerBoxCorner"] = dest.box.corner;
@@ -728,14 +1386,14 @@ bool SDFRenderer::runGenProgram(RenderContext* pContext, ComputeProgramWrapper&
         break;
     case Source_Type::MeshCalc:
         comp["triangleBuffer"] = genDesc.sourceDesc.mesh.buffer;
+        comp["chunkBoxBuffer"] = genDesc.sourceDesc.mesh.chunkBoxBuffer;
+        if (genDesc.sourceDesc.needsMeshBVH())
+            comp["bvhBuffer"] = genDesc.sourceDesc.mesh.bvhBuffer;
         break;
     default:
-        msgBox("Error", "[SDFRenderer::runGenProgram] Unsupported Source_Type", MsgBoxType::Ok, MsgBoxIcon::Error);
+        msgBox("Error", "[SDFRenderer::setGenSourceParameters] Unsupported Source_Type", MsgBoxType::Ok, MsgBoxIcon::Error);
         return false;
     }
-
-    comp.runProgram(dispatchRes);
-
     return true;
 }
 
@@ -818,14 +1476,41 @@ void SDFRenderer::onFrameRender(RenderContext* pRenderContext, const ref<Fbo>& p
         auto& s = state();
         s.mGenSettings.sourceDesc.sdfToResample = s.mpSDF ? std::move(s.mpSDF) : nullptr;
         s.mGenSettings.sourceDesc.updatePointers(&mProceduralSDFList);
+        if (s.mGenSettings.sourceDesc.needsMeshBVH())
+            s.mGenSettings.sourceDesc.mesh.buildBVH(mpDevice); // only builds once per mesh
+        const auto& pSource = s.mGenSettings.sourceDesc.sdfToResample;
+        s.mpPreviousSDF = pSource && pSource->sdfState == SDF_State::Complete ? pSource : nullptr;
+        s.mpPreviousTraceProg = s.mpActiveTraceProg;
         s.mpSDF = s.generateSDF(mpDevice, *this, pRenderContext, s.mGenSettings);
         s.mGenSettings.sourceDesc.sdfToResample = nullptr;
+        if (!s.mpSDF || s.mpSDF->sdfState != SDF_State::Generating) {
+            s.mpPreviousSDF.reset();
+            s.mpPreviousTraceProg.reset();
+        }
+        s.mGenScheduler.reset();
     }
 
     auto& s = state();
 
-    // Generate chunks as long as we have unprocessed input and output and do nothing else
-    if (s.GenerateFieldChunk(*this, pRenderContext)) return;
+    // Generate chunks within the frame budget, the previous SDF is rendered in the meantime
+    if (s.mpSDF && s.mpSDF->sdfState == SDF_State::Generating) {
+        auto pProfiler = pRenderContext->getProfiler();
+        if (!pProfiler->isEnabled()) {
+            pProfiler->setEnabled(true);
+            s.mGenScheduler.enabledProfiler = true;
+        }
+        const auto pEvent = pProfiler->getEvent("/onFrameRender/" + std::string(kGenProfilerEvent));
+        s.mGenScheduler.update(pEvent ? pEvent->getGpuTime() : 0.f);
+        ScopedProfilerEvent pe(pRenderContext, kGenProfilerEvent);
+        uint dispatchCount = 0;
+        while (dispatchCount < s.mGenScheduler.dispatchesPerFrame && s.GenerateFieldChunk(*this, pRenderContext))
+            ++dispatchCount;
+        s.mGenScheduler.endFrame(dispatchCount);
+    }
+    if (s.mGenScheduler.enabledProfiler && !(s.mpSDF && s.mpSDF->sdfState == SDF_State::Generating)) {
+        pRenderContext->getProfiler()->setEnabled(false);
+        s.mGenScheduler.enabledProfiler = false;
+    }
 
     s.PostProcess(mpDevice, *this, pRenderContext);
 
@@ -834,8 +1519,10 @@ void SDFRenderer::onFrameRender(RenderContext* pRenderContext, const ref<Fbo>& p
         s.mDoMakeTraceProgram = false;
         setActiveTraceProgram(s.mTraceProgramSettings);
     }
-    // camera
-    mpCameraController->update();
+    // camera, the flythrough playback drives it instead of the controller
+    if (!mFlythrough.isPlaying())
+        mpCameraController->update();
+    mFlythrough.startFrame(pRenderContext);
     mpCamera->beginFrame();
 
     // automatic testing
@@ -844,7 +1531,7 @@ void SDFRenderer::onFrameRender(RenderContext* pRenderContext, const ref<Fbo>& p
 
     // render SDF
     {
-        const auto& name = mPerfTester.testState == PerformanceTester::TestState::Running ? mPerfTester.testName : "model";
+        const auto& name = mPerfTester.testState == PerformanceTester::TestState::Running ? mPerfTester.testName : kTraceProfilerEvent;
         ScopedProfilerEvent pe(pRenderContext, name);
         s.RenderSDF(*this, pRenderContext, pTargetFbo);
     }
@@ -855,19 +1542,25 @@ void SDFRenderer::onFrameRender(RenderContext* pRenderContext, const ref<Fbo>& p
     // automatic testing
     mConvTester.endFrame();
     mPerfTester.endFrame(pRenderContext);
-    mScreenCapture.captureIfRequested(pTargetFbo);
+    mFlythrough.endFrame(pRenderContext);
+    mScreenCapture.captureIfRequested(pRenderContext, pTargetFbo, mAsyncCapture);
+    mAsyncCapture.endFrame();
 }
 
 bool SDFRenderer::ProgramState::RenderSDF(SDFRenderer& app, RenderContext* pRenderContext, const ref<Fbo>& pTargetFbo)
 {
-    if (!(mRendSettings.renderSDF && mpActiveTraceProg && mpSDF)) return false;
+    // the previous SDF is rendered while the new one is generated
+    const bool generating = mpSDF && mpSDF->sdfState == SDF_State::Generating;
+    const auto& pSDF = generating ? mpPreviousSDF : mpSDF;
+    const auto& pTraceProg = generating ? mpPreviousTraceProg : mpActiveTraceProg;
+    if (!(mRendSettings.renderSDF && pTraceProg && pSDF)) return false;
 
     const auto& pDevice = pRenderContext->getDevice();
     const auto& camPos = app.mpCamera->getPosition();
     const auto camDir = normalize(app.mpCamera->getTarget() - camPos);
     const float planeDist = dot(camPos, camDir) + app.mpCamera->getNearPlane();
-    const BBox innerBox = mpSDF->desc.calcInnerBox();
-    auto& activeTraceProg = *mpActiveTraceProg;
+    const BBox innerBox = pSDF->desc.calcInnerBox();
+    auto& activeTraceProg = *pTraceProg;
 
     activeTraceProg["VScb"]["modelScale"] = innerBox.size;
     activeTraceProg["VScb"]["modelTrans"] = innerBox.corner;
@@ -882,19 +1575,22 @@ bool SDFRenderer::ProgramState::RenderSDF(SDFRenderer& app, RenderContext* pRend
     activeTraceProg["PScb"]["maxStep"] = mRendSettings.primaryTraceStepNum;
     activeTraceProg["PScb"]["traceEpsilon"] = mRendSettings.traceEpsilon;
     activeTraceProg["PScb"]["stepRelaxation"] = [&]() {
-        switch (mpSDF->programDesc.SDF_TRACE_FUN_NUM) {
+        switch (pSDF->programDesc.SDF_TRACE_FUN_NUM) {
         case 2:
             return mRendSettings.relaxedParam;
         case 3:
             return mRendSettings.enhancedParam;
         case 4:
+        case 7:
             return mRendSettings.autoParam;
+        case 6:
+            return mRendSettings.segmentParam;
         default:
             return mRendSettings.relaxedParam;
         }
     }();
 
-    mpSDF->setModelParameters(activeTraceProg.getRootVar());
+    pSDF->setModelParameters(activeTraceProg.getRootVar());
     activeTraceProg["SHADEcb"]["shadeNormalEps"] = mRendSettings.shadeNormalEps;
     activeTraceProg["SHADEcb"]["shadowNormalEps"] = mRendSettings.shadowNormalEps;
     activeTraceProg["SHADEcb"]["lightDir"] = mRendSettings.lightDir;
@@ -904,10 +1600,11 @@ bool SDFRenderer::ProgramState::RenderSDF(SDFRenderer& app, RenderContext* pRend
     activeTraceProg["sdfSampler"] = app.mpLinearSampler;
 
     // debug calculations
-    if (mpSDF->programDesc.ENABLE_DEBUG_UTILS) {
+    if (pSDF->programDesc.ENABLE_DEBUG_UTILS) {
         activeTraceProg["debugCB"]["screenResolution"] = uint2(pTargetFbo->getWidth(), pTargetFbo->getHeight());
         activeTraceProg["debugCB"]["saveDepthToDebugTexture"] = mDebug.doSaveDepthToTexture;
         activeTraceProg["debugCB"]["saveConvergence"] = mDebug.doCountConvergence;
+        activeTraceProg["debugCB"]["saveConvergenceHistogram"] = mDebug.doCountConvergenceHistogram;
         if (mDebug.doSaveDepthToTexture) {
             mDebug.debugTexture = pDevice->createTexture2D(
                 pTargetFbo->getWidth(), pTargetFbo->getHeight(), ResourceFormat::R32Float, 1, 1, nullptr,
@@ -917,6 +1614,48 @@ bool SDFRenderer::ProgramState::RenderSDF(SDFRenderer& app, RenderContext* pRend
         }
         const static uint zeros[3] = { 0,0,0 };
         activeTraceProg.allocateStructuredBuffer("debugBuffer", 3, zeros);
+        const uint histogramSize = mDebug.doCountConvergenceHistogram ? 1 + 3 * (mRendSettings.primaryTraceStepNum + 1) : 1;
+        const std::vector<uint> histogramZeros(histogramSize, 0u);
+        activeTraceProg.allocateStructuredBuffer("convergenceHistogram", histogramSize, histogramZeros.data());
+    }
+
+    // conservative start depth of the primary rays per tile
+    if (pSDF->programDesc.CONE_PREPASS) {
+        const uint2 screenSize = uint2(pTargetFbo->getWidth(), pTargetFbo->getHeight());
+        const uint2 tileCount = div_round_up(screenSize, uint2(kConeTileSize));
+        auto& pDepthTex = app.mpConeDepthTexture;
+        if (!pDepthTex || pDepthTex->getWidth() != tileCount.x || pDepthTex->getHeight() != tileCount.y) {
+            pDepthTex = pDevice->createTexture2D(
+                tileCount.x, tileCount.y, ResourceFormat::R32Float, 1, 1, nullptr,
+                ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess
+            );
+        }
+        if (auto pConeProg = app.getConePrepassProgram(pSDF->programDesc)) {
+            auto& coneProg = *pConeProg;
+            pSDF->setModelParameters(coneProg.getRootVar());
+            coneProg["sdfSampler"] = app.mpLinearSampler;
+            coneProg["CONEcb"]["inverseViewProj"] = app.mpCamera->getInvViewProjMatrix();
+            coneProg["CONEcb"]["camPos"] = camPos;
+            coneProg["CONEcb"]["screenSize"] = screenSize;
+            coneProg["CONEcb"]["tileCount"] = tileCount;
+            coneProg["CONEcb"]["maxStep"] = kConePrepassMaxStep;
+            coneProg["CONEcb"]["traceEpsilon"] = mRendSettings.traceEpsilon;
+            coneProg["tileDepth"] = pDepthTex;
+            coneProg.runProgram(uint3(tileCount, 1));
+        }
+        else {
+            // no start depth: the rays start at the bounding box
+            pRenderContext->clearUAV(pDepthTex->getUAV().get(), float4(0.f));
+        }
+        activeTraceProg["coneDepthTex"] = pDepthTex;
+    }
+
+    if (pSDF->programDesc.TEMPORAL_REPROJECTION) {
+        const uint2 screenSize = uint2(pTargetFbo->getWidth(), pTargetFbo->getHeight());
+        app.mTemporalReprojection.beginFrame(pRenderContext, screenSize, *app.mpCamera, activeTraceProg, mRendSettings.reprojectionMargin);
+    }
+    else {
+        app.mTemporalReprojection.valid = false;
     }
 
     // rendering
@@ -938,8 +1677,11 @@ bool SDFRenderer::ProgramState::RenderSDF(SDFRenderer& app, RenderContext* pRend
         activeTraceProg["VScb"]["type"] = 2u;
         activeTraceProg.draw(pRenderContext, pTargetFbo, 14);
     }
+    if (pSDF->programDesc.TEMPORAL_REPROJECTION) {
+        app.mTemporalReprojection.endFrame(*app.mpCamera);
+    }
     // retrieving debug calculations
-    if (mpSDF->programDesc.ENABLE_DEBUG_UTILS) {
+    if (pSDF->programDesc.ENABLE_DEBUG_UTILS) {
         if (mDebug.doCountConvergence) {
             mDebug.doCountConvergence = false;
             auto pVals = activeTraceProg.mapBuffer<const uint>("debugBuffer");
@@ -948,6 +1690,13 @@ bool SDFRenderer::ProgramState::RenderSDF(SDFRenderer& app, RenderContext* pRend
             mDebug.convergedMissCount = pVals[2];
             activeTraceProg.unmapBuffer("debugBuffer");
         }
+        if (mDebug.doCountConvergenceHistogram) {
+            mDebug.doCountConvergenceHistogram = false;
+            const uint histogramSize = 1 + 3 * (mRendSettings.primaryTraceStepNum + 1);
+            auto pVals = activeTraceProg.mapBuffer<const uint>("convergenceHistogram");
+            mDebug.convergenceHistogram.assign(pVals, pVals + histogramSize);
+            activeTraceProg.unmapBuffer("convergenceHistogram");
+        }
         if (mDebug.doSaveDepthToTexture) {
             mDebug.doSaveDepthToTexture = false;
         }
@@ -955,6 +1704,47 @@ bool SDFRenderer::ProgramState::RenderSDF(SDFRenderer& app, RenderContext* pRend
     return true;
 }
 
+void SDFRenderer::TemporalReprojection::beginFrame(RenderContext* pContext, uint2 screenSize, const Camera& camera, GraphicsProgramWrapper& traceProg, float margin)
+{
+    const auto& pDevice = pContext->getDevice();
+    if (!pHitDepth || pHitDepth->getWidth() != screenSize.x || pHitDepth->getHeight() != screenSize.y) {
+        const auto flags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
+        pHitDepth = pDevice->createTexture2D(screenSize.x, screenSize.y, ResourceFormat::R32Float, 1, 1, nullptr, flags);
+        pHint = pDevice->createTexture2D(screenSize.x, screenSize.y, ResourceFormat::R32Uint, 1, 1, nullptr, flags);
+        valid = false;
+    }
+    if (!pReprojectProg) {
+        pReprojectProg = ComputeProgramWrapper::create(pDevice);
+        pReprojectProg->createProgram(kSDir / "temporalReproject.cs.slang", "reproject_main");
+    }
+
+    pContext->clearUAV(pHint->getUAV().get(), uint4(0xffffffffu));
+    if (valid) {
+        auto& prog = *pReprojectProg;
+        prog["REPROJcb"]["prevInvViewProj"] = prevInvViewProj;
+        prog["REPROJcb"]["prevCamPos"] = prevCamPos;
+        prog["REPROJcb"]["viewProj"] = camera.getViewProjMatrix();
+        prog["REPROJcb"]["camPos"] = camera.getPosition();
+        prog["REPROJcb"]["screenSize"] = screenSize;
+        prog["prevHitDepth"] = pHitDepth;
+        prog["reprojHint"] = pHint;
+        prog.runProgram(uint3(screenSize, 1));
+    }
+    // the pixels that don't trace (outside of the box) don't write it
+    pContext->clearUAV(pHitDepth->getUAV().get(), float4(0.f));
+
+    traceProg["REPROJcb"]["reprojMargin"] = margin;
+    traceProg["reprojHintTex"] = pHint;
+    traceProg["hitDepthTex"] = pHitDepth;
+}
+
+void SDFRenderer::TemporalReprojection::endFrame(const Camera& camera)
+{
+    prevInvViewProj = camera.getInvViewProjMatrix();
+    prevCamPos = camera.getPosition();
+    valid = true;
+}
+
 bool SDFRenderer::ProgramState::RenderBB(SDFRenderer& app, RenderContext* pRenderContext, const ref<Fbo>& pTargetFbo)
 {
     if (!mRendSettings.renderSDFBBox) {
@@ -986,7 +1776,8 @@ bool SDFRenderer::ProgramState::RenderBB(SDFRenderer& app, RenderContext* pRende
 
 void SDFRenderer::onShutdown()
 {
-    
+    // the pending readbacks need the device
+    mAsyncCapture.flush();
 }
 
 bool SDFRenderer::onKeyEvent(const KeyboardEvent& keyEvent)
@@ -1056,6 +1847,9 @@ bool SDFRenderer::onGamepadState(const GamepadState& gamepadState)
 
 void SDFRenderer::onHotReload(HotReloadFlags reloaded)
 {
+    // drop the programs compiled from the previous shader sources
+    if (is_set(reloaded, HotReloadFlags::Program))
+        mTraceProgramCache.clear();
 }
 
 void SDFRenderer::onResize(uint32_t width, uint32_t height)
@@ -1092,6 +1886,12 @@ void SDFRenderer::ConvergenceTester::resumeTest()
 void SDFRenderer::ConvergenceTester::startFrame()
 {
     if (testState != TestState::Running) return;
+    if (singlePass) {
+        app.state().mRendSettings.primaryTraceStepNum = endStepNum;
+        app.state().mDebug.doCountConvergenceHistogram = true;
+        app.state().mDebug.convergenceHistogram.clear();
+        return;
+    }
     app.state().mRendSettings.primaryTraceStepNum = currentStepNum;
     app.state().mDebug.doCountConvergence = true;
 }
@@ -1099,6 +1899,12 @@ void SDFRenderer::ConvergenceTester::startFrame()
 void SDFRenderer::ConvergenceTester::endFrame()
 {
     if (testState != TestState::Running) return;
+    if (singlePass) {
+        resultsFromHistogram(app.state().mDebug.convergenceHistogram);
+        currentStepNum = endStepNum + 1;
+        testState = TestState::Ended;
+        return;
+    }
     results.emplace_back(Result{
         currentStepNum,
         app.state().mDebug.nonConvergedCount,
@@ -1109,6 +1915,30 @@ void SDFRenderer::ConvergenceTester::endFrame()
     if (currentStepNum > endStepNum)
         testState = TestState::Ended;
 }
+
+// The trace loop with N max steps runs the same iterations as the first N iterations with more max steps.
+// So a ray that reached the hit or miss condition at step s is converged for every N >= s,
+// and non-converged for every N < s.
+void SDFRenderer::ConvergenceTester::resultsFromHistogram(const std::vector<uint>& histogram)
+{
+    results.clear();
+    if (histogram.size() < 1 + 3 * (endStepNum + 1)) {
+        // the debug utils are not enabled, or the histogram was not read back
+        msgBox("Error", "[ConvergenceTester::resultsFromHistogram] The step histogram is not available, set ENABLE_DEBUG_UTILS", MsgBoxType::Ok, MsgBoxIcon::Error);
+        return;
+    }
+    const uint coveredCount = histogram[0];
+    uint hitSum = 0, missSum = 0, convergedSum = 0;
+    for (uint s = 0; s <= endStepNum; ++s) {
+        hitSum += histogram[1 + 3 * s + 0];
+        missSum += histogram[1 + 3 * s + 1];
+        convergedSum += histogram[1 + 3 * s + 2];
+        if (s < startStepNum)
+            continue;
+        results.emplace_back(Result{ s, coveredCount - convergedSum, hitSum, missSum });
+    }
+}
+
 void SDFRenderer::ConvergenceTester::renderGui(Gui::Widgets& w)
 {
     switch (testState)
@@ -1116,6 +1946,8 @@ void SDFRenderer::ConvergenceTester::renderGui(Gui::Widgets& w)
     case SDFRenderer::ConvergenceTester::TestState::NotTesting:
         w.var("Starting step num", startStepNum, 1u, 500u);
         w.var("Last step num", endStepNum, startStepNum, 500u);
+        w.checkbox("Single pass", singlePass);
+        w.tooltip("Render one frame with the last step num and compute all results from the per-step histogram of the rays");
         if (w.button("Start test")) {
             startTest(startStepNum, endStepNum);
         }
@@ -1272,6 +2104,10 @@ void SDFRenderer::PerformanceTester::renderGui(Gui::Widgets& w)
             param = &app.state().mRendSettings.autoParam;
             paramName = "autoParam";
         }
+        if (w.button("Set tested parameter to `segmentParam`")) {
+            param = &app.state().mRendSettings.segmentParam;
+            paramName = "segmentParam";
+        }
         /** /
         if (w.button("Start test##preftest")) {
             startTest();
@@ -1328,6 +2164,260 @@ std::ostream& operator<<(std::ostream& os, const SDFRenderer::PerformanceTester:
     return os << r.param << '\t' << r.stats.min << '\t' << r.stats.max << '\t' << r.stats.mean << '\t' << r.stats.stdDev;
 }
 
+void SDFRenderer::FlythroughTester::startRecording()
+{
+    path.frames.clear();
+    path.frameTime = 0.f;
+    recordStartTime = std::chrono::high_resolution_clock::now();
+    testState = TestState::Recording;
+}
+
+void SDFRenderer::FlythroughTester::stopRecording()
+{
+    if (testState != TestState::Recording) return;
+    const std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now() - recordStartTime;
+    path.frameTime = path.frames.size() > 1 ? elapsed.count() / (path.frames.size() - 1) : 0.f;
+    testState = TestState::NotTesting;
+}
+
+bool SDFRenderer::FlythroughTester::startPlayback(RenderContext* pRenderContext)
+{
+    const auto& s = app.state();
+    if (path.frames.empty() || !s.mpSDF || s.mpSDF->sdfState != SDF_State::Complete)
+        return false;
+    results.clear();
+    for (uint i = 0; i < kTraceFunctionCount; ++i) {
+        if (testTraceFunction[i])
+            results.push_back(TracerResult{ int(i + 1), std::vector<FrameResult>(path.frames.size()), {} });
+    }
+    if (results.empty())
+        return false;
+
+    auto pProfiler = pRenderContext->getProfiler();
+    enabledProfiler = !pProfiler->isEnabled();
+    pProfiler->setEnabled(true);
+    savedTraceDesc = s.mTraceProgramSettings;
+    tracerIndex = 0;
+    statisticsPass = false;
+    testState = TestState::Playing;
+    beginPass();
+    return true;
+}
+
+void SDFRenderer::FlythroughTester::stopPlayback(RenderContext* pRenderContext)
+{
+    if (testState == TestState::Playing)
+        finish(pRenderContext);
+}
+
+void SDFRenderer::FlythroughTester::beginPass()
+{
+    SDF_TraceProgram_Desc desc = savedTraceDesc;
+    desc.SDF_TRACE_FUN_NUM = results[tracerIndex].traceFunction;
+    desc.ENABLE_DEBUG_UTILS = statisticsPass;
+    app.setActiveTraceProgram(desc);
+    currFrame = -int(kWarmupFrames);
+}
+
+void SDFRenderer::FlythroughTester::finish(RenderContext* pRenderContext)
+{
+    app.setActiveTraceProgram(savedTraceDesc);
+    if (enabledProfiler) {
+        pRenderContext->getProfiler()->setEnabled(false);
+        enabledProfiler = false;
+    }
+    for (auto& r : results) {
+        std::vector<float> times(r.frames.size());
+        for (size_t i = 0; i < times.size(); ++i)
+            times[i] = r.frames[i].gpuTime;
+        r.gpuTimeStats = Profiler::Stats::compute(times.data(), times.size());
+    }
+    testState = TestState::Ended;
+}
+
+void SDFRenderer::FlythroughTester::startFrame(RenderContext* pRenderContext)
+{
+    if (testState == TestState::Recording) {
+        const auto& cam = app.mpCamera;
+        path.frames.push_back(CameraPathFrame{ cam->getPosition(), cam->getTarget(), cam->getUpVector(), cam->getFocalLength() });
+        return;
+    }
+    if (testState != TestState::Playing) return;
+
+    // the warm-up and the frames waiting for the GPU time stay on the first and the last pose
+    const int frameCount = int(path.frames.size());
+    const auto& f = path.frames[std::clamp(currFrame, 0, frameCount - 1)];
+    app.mpCamera->setPosition(f.position);
+    app.mpCamera->setTarget(f.target);
+    app.mpCamera->setUpVector(f.up);
+    app.mpCamera->setFocalLength(f.focalLength);
+
+    if (statisticsPass && currFrame >= 0) {
+        app.state().mDebug.doCountConvergenceHistogram = true;
+        app.state().mDebug.convergenceHistogram.clear();
+    }
+}
+
+void SDFRenderer::FlythroughTester::endFrame(RenderContext* pRenderContext)
+{
+    if (testState != TestState::Playing) return;
+
+    const int frameCount = int(path.frames.size());
+    auto& frames = results[tracerIndex].frames;
+    bool passEnded = false;
+    if (!statisticsPass) {
+        const int measuredFrame = currFrame - int(kGpuTimeLatency);
+        if (measuredFrame >= 0) {
+            const auto& e = pRenderContext->getProfiler()->getEvent("/onFrameRender/"s + kTraceProfilerEvent);
+            if (!e) {
+                msgBox("Error", "[FlythroughTester::endFrame] Couldn't make measurements", MsgBoxType::Ok, MsgBoxIcon::Error);
+                finish(pRenderContext);
+                return;
+            }
+            frames[measuredFrame].gpuTime = e->getGpuTime();
+        }
+        passEnded = measuredFrame == frameCount - 1;
+    }
+    else if (currFrame >= 0) {
+        // see convergenceHistogram in cube_main.ps.slang
+        const auto& histogram = app.state().mDebug.convergenceHistogram;
+        const uint maxStep = app.state().mRendSettings.primaryTraceStepNum;
+        if (histogram.size() < 1 + 3 * (maxStep + 1)) {
+            msgBox("Error", "[FlythroughTester::endFrame] The step histogram is not available", MsgBoxType::Ok, MsgBoxIcon::Error);
+            finish(pRenderContext);
+            return;
+        }
+        auto& r = frames[currFrame];
+        const uint coveredCount = histogram[0];
+        uint convergedSum = 0;
+        uint64_t stepSum = 0;
+        r.convergedHitCount = r.convergedMissCount = 0;
+        for (uint s = 0; s <= maxStep; ++s) {
+            r.convergedHitCount += histogram[1 + 3 * s + 0];
+            r.convergedMissCount += histogram[1 + 3 * s + 1];
+            convergedSum += histogram[1 + 3 * s + 2];
+            stepSum += uint64_t(s) * histogram[1 + 3 * s + 2];
+        }
+        r.nonConvergedCount = coveredCount - convergedSum;
+        stepSum += uint64_t(maxStep) * r.nonConvergedCount;
+        r.meanStepCount = coveredCount > 0 ? float(double(stepSum) / coveredCount) : 0.f;
+        passEnded = currFrame == frameCount - 1;
+    }
+    currFrame++;
+    if (!passEnded) return;
+
+    // next pass
+    if (collectStatistics && !statisticsPass) {
+        statisticsPass = true;
+    }
+    else {
+        statisticsPass = false;
+        if (++tracerIndex == results.size()) {
+            finish(pRenderContext);
+            return;
+        }
+    }
+    beginPass();
+}
+
+void SDFRenderer::FlythroughTester::renderGui(Gui::Widgets& w, RenderContext* pRenderContext)
+{
+    switch (testState)
+    {
+    case TestState::NotTesting:
+    {
+        ImGui::Text("Camera path: %u frames", (uint)path.frames.size());
+        if (w.button("Start recording##flythrough")) {
+            startRecording();
+        }
+        if (w.button("Load path...##flythrough", true)) {
+            FileDialogFilterVec filters;
+            filters.push_back({ "campath", "Camera Path Files" });
+            std::filesystem::path file;
+            std::string error;
+            if (openFileDialog(filters, file) && !path.read(file, error)) {
+                msgBox("Error", "[FlythroughTester::renderGui] " + error, MsgBoxType::Ok, MsgBoxIcon::Error);
+            }
+        }
+        if (!path.frames.empty() && w.button("Save path...##flythrough", true)) {
+            FileDialogFilterVec filters;
+            filters.push_back({ "campath", "Camera Path Files" });
+            std::filesystem::path file = "flythrough.campath";
+            std::string error;
+            if (saveFileDialog(filters, file) && !path.write(file, error)) {
+                msgBox("Error", "[FlythroughTester::renderGui] " + error, MsgBoxType::Ok, MsgBoxIcon::Error);
+            }
+        }
+        w.text("Tracers:");
+        for (uint i = 0; i < kTraceFunctionCount; ++i) {
+            w.checkbox((std::string(kTraceFunctionNames[i]) + "##flythrough").c_str(), testTraceFunction[i], i % 3 != 0);
+        }
+        w.checkbox("Collect step statistics", collectStatistics);
+        w.tooltip("Play the path again with ENABLE_DEBUG_UTILS for the step and convergence counts of every frame");
+        if (w.button("Start playback##flythrough")) {
+            if (!startPlayback(pRenderContext)) {
+                msgBox("Error", "[FlythroughTester::renderGui] Couldn't start the playback, record a path, select a tracer and generate an SDF first", MsgBoxType::Ok, MsgBoxIcon::Error);
+            }
+        }
+        break;
+    }
+    case TestState::Recording:
+        ImGui::Text("Recording: %u frames", (uint)path.frames.size());
+        if (w.button("Stop recording##flythrough")) {
+            stopRecording();
+        }
+        break;
+    case TestState::Playing:
+        w.text("Close the GUI (F2) for more accurate measurements");
+        ImGui::Text("Tracer %u / %u (%s pass)\nFrame: %i / %u",
+            tracerIndex + 1, (uint)results.size(), statisticsPass ? "statistics" : "timing", currFrame, (uint)path.frames.size());
+        if (w.button("Stop playback##flythrough")) {
+            stopPlayback(pRenderContext);
+        }
+        break;
+    case TestState::Ended:
+        for (const auto& r : results) {
+            ImGui::Text("%s: %.4f ms avg, %.4f ms max", kTraceFunctionNames[r.traceFunction - 1], r.gpuTimeStats.mean, r.gpuTimeStats.max);
+        }
+        if (w.button("Save results to file...##flythrough")) {
+            FileDialogFilterVec filters;
+            filters.push_back({ "txt", "Text Files" });
+            std::filesystem::path file;
+            if (saveFileDialog(filters, file)) {
+                std::ofstream of(file);
+                printResults(of);
+            }
+        }
+        if (w.button("Copy results to clipboard##flythrough", true)) {
+            std::stringstream ss;
+            ss << app.state().getModelAndSettingsString() << "\n";
+            printResults(ss);
+            ImGui::SetClipboardText(ss.str().c_str());
+        }
+        if (w.button("New test##flythrough")) {
+            testState = TestState::NotTesting;
+        }
+        break;
+    }
+}
+
+void SDFRenderer::FlythroughTester::printResults(std::ostream& os)
+{
+    os << "tracer\tmin\tmax\tavg\tstdDev\n";
+    for (const auto& r : results) {
+        const auto& s = r.gpuTimeStats;
+        os << r.traceFunction << '\t' << s.min << '\t' << s.max << '\t' << s.mean << '\t' << s.stdDev << '\n';
+    }
+    os << "\ntracer\tframe\tgpuTime\tmeanStepCount\tnonConvergedCount\tconvergedHitCount\tconvergedMissCount\n";
+    for (const auto& r : results) {
+        for (size_t i = 0; i < r.frames.size(); ++i) {
+            const auto& f = r.frames[i];
+            os << r.traceFunction << '\t' << i << '\t' << f.gpuTime << '\t' << f.meanStepCount << '\t'
+                << f.nonConvergedCount << '\t' << f.convergedHitCount << '\t' << f.convergedMissCount << '\n';
+        }
+    }
+}
+
 
 
 namespace Falcor {
@@ -1371,15 +2461,20 @@ void SDFRenderer::ScreenCapture::captrueNextFrame(std::string fileName, std::fil
     mDirectory = directory;
 }
 
-void SDFRenderer::ScreenCapture::captureIfRequested(const ref<Fbo>& pTargetFbo)
+void SDFRenderer::ScreenCapture::captureIfRequested(RenderContext* pContext, const ref<Fbo>& pTargetFbo, AsyncCapture& capture)
 {
     if (mDoCapture)
     {
         mDoCapture = false;
         const std::string& f = mFileName == "" ? getExecutableName() : mFileName;
         std::filesystem::path d = mDirectory == "" ? mDefaultDirectory : mDirectory;
-        std::filesystem::path path = findAvailableFilename(f, d, "png");
-        pTargetFbo->getColorTexture(0).get()->captureToFile(0, 0, path);
+        // like findAvailableFilename, but the captures that are not written yet are taken as well
+        std::filesystem::path path;
+        for (uint i = 0;; ++i) {
+            path = d / (f + "." + std::to_string(i) + ".png");
+            if (!std::filesystem::exists(path) && !capture.isPending(path)) break;
+        }
+        capture.capture(pContext, pTargetFbo->getColorTexture(0), path);
     }
 }
 
@@ -31,9 +31,14 @@
 
 #include "Utils/ComputeProgramWrapper.h"
 #include "Utils/GraphicsProgramWrapper.h"
+#include "Utils/lru_cache.hpp"
 
+#include "AsyncCapture.h"
+#include "CameraPath.h"
 #include "SDF.h"
+#include "SDFCache.h"
 
+#include <array>
 #include <unordered_map>
 
 using namespace Falcor;
@@ -70,12 +75,15 @@ public:
         uint currentStepNum = 1;
         uint startStepNum = 1;
         uint endStepNum = 200;
+        // trace once with endStepNum steps and get every step count from the step histogram
+        bool singlePass = true;
         std::vector<Result> results;
         void startTest(uint minNum, uint maxNum);
         void pauseTest();
         void resumeTest();
         void startFrame();
         void endFrame();
+        void resultsFromHistogram(const std::vector<uint>& histogram);
         void printResults(std::ostream& os);
         void renderGui(Gui::Widgets& w);
     };
@@ -110,6 +118,61 @@ public:
         void printResults(std::ostream& os);
         void renderGui(Gui::Widgets& w);
     };
+    friend struct FlythroughTester;
+    // Records the live camera into a CameraPath, and plays it back frame locked once for every selected tracer.
+    // A tracer is played in a timing pass, then in a statistics pass with ENABLE_DEBUG_UTILS,
+    // so the atomics of the step histogram don't distort the measured GPU times.
+    struct FlythroughTester
+    {
+        struct FrameResult {
+            float gpuTime = 0.f;
+            float meanStepCount = 0.f;
+            uint nonConvergedCount = 0;
+            uint convergedHitCount = 0;
+            uint convergedMissCount = 0;
+        };
+        struct TracerResult {
+            int traceFunction;
+            std::vector<FrameResult> frames;
+            Profiler::Stats gpuTimeStats;
+        };
+        enum class TestState { NotTesting, Recording, Playing, Ended };
+        // the profiler reports the GPU time of an event in the next frame
+        static constexpr uint kGpuTimeLatency = 1;
+        // frames rendered from the first pose before every pass, not measured
+        static constexpr uint kWarmupFrames = 3;
+        static constexpr uint kTraceFunctionCount = 7;
+
+        FlythroughTester(SDFRenderer& app) : app(app) {}
+        SDFRenderer& app;
+        // state
+        TestState testState = TestState::NotTesting;
+        CameraPath path;
+        std::chrono::high_resolution_clock::time_point recordStartTime;
+        std::vector<TracerResult> results;
+        uint tracerIndex = 0;
+        bool statisticsPass = false;
+        int currFrame = 0;                  // negative during the warm-up
+        SDF_TraceProgram_Desc savedTraceDesc;
+        bool enabledProfiler = false;
+        // settings
+        bool testTraceFunction[kTraceFunctionCount] = { true, false, false, false, false, false, false }; // SDF_TRACE_FUN_NUM - 1
+        bool collectStatistics = true;
+
+        void startRecording();
+        void stopRecording();
+        bool startPlayback(RenderContext* pRenderContext);
+        void stopPlayback(RenderContext* pRenderContext); // stop early, the results so far are kept
+        bool isPlaying() const { return testState == TestState::Playing; }
+        // after the camera controller update, records or sets the camera and switches the tracer
+        void startFrame(RenderContext* pRenderContext);
+        void endFrame(RenderContext* pRenderContext);
+        void printResults(std::ostream& os);
+        void renderGui(Gui::Widgets& w, RenderContext* pRenderContext);
+    private:
+        void beginPass();
+        void finish(RenderContext* pRenderContext);
+    };
 
 
     // In each frame, we process an input voxel until we iterate over the entire input.
@@ -141,16 +204,42 @@ public:
         uint3 outputRes{ 1,1,1 };
         SDF_Generation_Desc genDesc;
     };
+    // number of frame-distributed generation dispatches per frame, adapted to a GPU time budget
+    struct GenerationScheduler
+    {
+        float frameBudgetMs = 8.f;          // GPU time of the generation dispatches in a frame
+        uint maxDispatchesPerFrame = 1024;
+        uint dispatchesPerFrame = 1;
+        float dispatchCostMs = 0.f;         // moving average of the GPU time of one dispatch
+        bool enabledProfiler = false;       // the profiler was turned on for the measurements
+        // the profiler reports the GPU time of a frame this many frames later
+        static constexpr uint kGpuTimeLatency = FlythroughTester::kGpuTimeLatency;
+        // dispatches issued in the last frames, [frame % size], so a GPU time is divided by the count of its frame
+        std::array<uint, kGpuTimeLatency + 1> dispatchCounts{};
+        uint frameIndex = 0;                // frames since the reset
+
+        void reset() { dispatchesPerFrame = 1; dispatchCostMs = 0.f; dispatchCounts.fill(0); frameIndex = 0; }
+        // call before the dispatches of a frame
+        // gpuTimeMs: the GPU time of the generation dispatches the profiler reports, 0 if unknown
+        void update(float gpuTimeMs);
+        // call after the dispatches of a frame
+        void endFrame(uint dispatchCount);
+        void renderGui(Gui::Widgets& w);
+    };
     struct DebugUtils {
         bool doSaveDepthToTexture = false;
         bool doCountConvergence = false;
+        bool doCountConvergenceHistogram = false;
         ref<Texture> debugTexture;
 
         uint nonConvergedCount = 0;
         uint convergedHitCount = 0;
         uint convergedMissCount = 0;
 
-        void renderGui(Gui::Widgets& w);
+        // see convergenceHistogram in cube_main.ps.slang, filled for primaryTraceStepNum
+        std::vector<uint> convergenceHistogram;
+
+        void renderGui(Gui::Widgets& w, RenderContext* pContext, AsyncCapture& capture);
     };
     struct ProgramState {
         // trace program
@@ -168,6 +257,10 @@ public:
         bool mDoGenerateSDF = false;
 
         SDF_Generation_State mGenState{};
+        GenerationScheduler mGenScheduler{};
+        // rendered while the new SDF is generated over several frames
+        std::shared_ptr<SDF> mpPreviousSDF;
+        ref<GraphicsProgramWrapper> mpPreviousTraceProg;
 
         SDF_TraceProgram_Desc mTraceProgramSettings;
         bool mDoMakeTraceProgram = false;
@@ -190,6 +283,12 @@ public:
             RenderContext* pContext,
             const SDF_Generation_Desc& genDesc
         );
+        // creates the brick atlas and the indirection texture of an SDF_Type::SparseBrick SDF
+        bool generateSparseBrickSDF(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, SDF& sdf);
+        // creates the UNORM8 brick atlas and the brick range texture of an SDF_Type::QuantizedBrick SDF
+        bool generateQuantizedBrickSDF(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, SDF& sdf);
+        // Mesh_Calc_Method::NarrowBand: fills the MeshCalcData of sdf.texture2 in one go, finishMeshCalc_main does the rest
+        bool generateNarrowBandMeshSDF(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, SDF& sdf);
 
         std::string getModelAndSettingsString();
     };
@@ -203,9 +302,46 @@ private:
 
     ref<GraphicsProgramWrapper> mpCubeWireProg;
 
-    static ref<ComputeProgramWrapper> createGenProgram(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc);
+    // entryOverride: use this entry point instead of the default one of the source type
+    static ref<ComputeProgramWrapper> createGenProgram(const ref<Device>& pDevice, const SDF_Generation_Desc& genDesc, const std::string& entryOverride = "");
+    // binds the source of the generation (MODELcb, source SDF or triangles)
+    static bool setGenSourceParameters(ComputeProgramWrapper& comp, const SDF_Generation_Desc& genDesc);
+    // fills mips >= 1 of an SDF0 texture with conservative lower bounds of the distance
+    static void buildMinDistanceMips(const ref<Device>& pDevice, const SDF& sdf);
+    // histogram of the gradients of the cells of mip 0 of an SDF0 texture, see Shaders/computeLipschitz.cs.slang
+    static SDF_Lipschitz_Stats measureLipschitz(const ref<Device>& pDevice, const SDF& sdf);
+    // corrects mip 0 of an SDF0 texture by genDesc.lipschitzFix, the min. distance mips have to be rebuilt after it
+    // stats: measured before the fix
+    static void fixLipschitz(const ref<Device>& pDevice, const SDF& sdf, const SDF_Lipschitz_Stats& stats);
+    // step hint volume of the hinted tracer (SDF_TRACE_FUN_NUM 7), see Shaders/computeStepHint.cs.slang
+    void buildStepHints(SDF& sdf);
     static ref<GraphicsProgramWrapper> createTraceProgram(const ref<Device>& pDevice, const SDF_TraceProgram_Desc& sdfType);
     void setActiveTraceProgram(const SDF_TraceProgram_Desc& sdfType);
+    // compiled trace programs, revisiting a configuration doesn't recompile the shaders
+    static constexpr size_t kTraceProgramCacheSize = 16;
+    LRUCache<SDF_TraceProgram_Desc, ref<GraphicsProgramWrapper>, SDF_TraceProgram_Desc::hash> mTraceProgramCache{ kTraceProgramCacheSize };
+    // SDF_TraceProgram_Desc::CONE_PREPASS: start depth of the primary rays per tile, see conePrepass.cs.slang
+    static ref<ComputeProgramWrapper> createConePrepassProgram(const ref<Device>& pDevice, const SDF_TraceProgram_Desc& traceDesc);
+    // compiled on first use, nullptr on failure
+    ComputeProgramWrapper* getConePrepassProgram(const SDF_TraceProgram_Desc& traceDesc);
+    LRUCache<SDF_TraceProgram_Desc, ref<ComputeProgramWrapper>, SDF_TraceProgram_Desc::hash> mConePrepassCache{ kTraceProgramCacheSize };
+    ref<Texture> mpConeDepthTexture;
+    // SDF_TraceProgram_Desc::TEMPORAL_REPROJECTION: hits of the last frame as ray start hints, see temporalReproject.cs.slang
+    struct TemporalReprojection {
+        ref<ComputeProgramWrapper> pReprojectProg;
+        ref<Texture> pHitDepth;     // ray distance of the hits of the last frame per pixel, 0 for misses
+        ref<Texture> pHint;         // asuint of the reprojected ray distance, ~0u where nothing was reprojected
+        float4x4 prevInvViewProj;
+        float3 prevCamPos;
+        bool valid = false;         // pHitDepth was written in the last frame
+
+        // reprojects the hits of the last frame and binds the textures to the trace program
+        void beginFrame(RenderContext* pContext, uint2 screenSize, const Camera& camera, GraphicsProgramWrapper& traceProg, float margin);
+        // call after the trace program was drawn with the textures
+        void endFrame(const Camera& camera);
+    } mTemporalReprojection;
+    // baked SDFs on the disk, see ProgramState::generateSDF
+    SDFCache mSDFCache;
 
     bool runGenProgram( RenderContext* pContext,
                         ComputeProgramWrapper& comp,
@@ -230,14 +366,18 @@ private:
 
     ConvergenceTester mConvTester{ *this };
     PerformanceTester mPerfTester{ *this };
+    FlythroughTester mFlythrough{ *this };
 
     float3 mBackgroundColor{ 1.f };
-    
+
+    // readback and encoding of the screen captures and the depth exports, off the render thread
+    AsyncCapture mAsyncCapture;
+
     class ScreenCapture
     {
     public:
         void captrueNextFrame(std::string fileName = "", std::filesystem::path directory = "");
-        void captureIfRequested(const ref<Fbo>& pTargetFbo);
+        void captureIfRequested(RenderContext* pContext, const ref<Fbo>& pTargetFbo, AsyncCapture& capture);
         void renderGui(Gui::Widgets& w);
     private:
         bool mDoCapture = false;
@@ -16,6 +16,9 @@ Gui::DropdownList makeDropdownList() {
 
 const Gui::DropdownList SDF_Type_list = makeDropdownList<SDF_Type>();
 const Gui::DropdownList Source_Type_list = makeDropdownList<Source_Type>();
+const Gui::DropdownList Mesh_Calc_Method_list = makeDropdownList<Mesh_Calc_Method>();
+const Gui::DropdownList Mesh_Sign_Method_list = makeDropdownList<Mesh_Sign_Method>();
+const Gui::DropdownList Lipschitz_Fix_list = makeDropdownList<Lipschitz_Fix>();
 
 template<typename ENUM>
 bool Dropdown_template(Gui::Widgets& w, const char label[], ENUM& var, bool sameLine, const Gui::DropdownList& list)
@@ -36,6 +39,18 @@ bool Dropdown(Gui::Widgets& w, const char label[], Source_Type& var, bool sameLi
 {
     return Dropdown_template(w, label, var, sameLine, Source_Type_list);
 }
+bool Dropdown(Gui::Widgets& w, const char label[], Mesh_Calc_Method& var, bool sameLine)
+{
+    return Dropdown_template(w, label, var, sameLine, Mesh_Calc_Method_list);
+}
+bool Dropdown(Gui::Widgets& w, const char label[], Mesh_Sign_Method& var, bool sameLine)
+{
+    return Dropdown_template(w, label, var, sameLine, Mesh_Sign_Method_list);
+}
+bool Dropdown(Gui::Widgets& w, const char label[], Lipschitz_Fix& var, bool sameLine)
+{
+    return Dropdown_template(w, label, var, sameLine, Lipschitz_Fix_list);
+}
 
 std::ostream& operator<<(std::ostream& os, SDF_Type val)
 {
@@ -45,3 +60,15 @@ std::ostream& operator<<(std::ostream& os, Source_Type val)
 {
     return magic_enum::ostream_operators::operator<<(os, val);
 }
+std::ostream& operator<<(std::ostream& os, Mesh_Calc_Method val)
+{
+    return magic_enum::ostream_operators::operator<<(os, val);
+}
+std::ostream& operator<<(std::ostream& os, Mesh_Sign_Method val)
+{
+    return magic_enum::ostream_operators::operator<<(os, val);
+}
+std::ostream& operator<<(std::ostream& os, Lipschitz_Fix val)
+{
+    return magic_enum::ostream_operators::operator<<(os, val);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// 64 bit FNV-1a hash, stable between runs and platforms (unlike std::hash), used for the on-disk SDF cache keys.
+class FNV1a
+{
+public:
+    static constexpr uint64_t kOffsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t kPrime = 1099511628211ull;
+
+    void add(const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            mHash ^= bytes[i];
+            mHash *= kPrime;
+        }
+    }
+    // trivially copyable values without padding (scalars, enums, vectors of floats)
+    template<typename T>
+    void addValue(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only raw bytes are hashed");
+        add(&value, sizeof(T));
+    }
+    // the length is hashed too, so consecutive strings can't alias
+    void addString(const std::string& str)
+    {
+        addValue((uint64_t)str.size());
+        add(str.data(), str.size());
+    }
+
+    uint64_t get() const { return mHash; }
+
+private:
+    uint64_t mHash = kOffsetBasis;
+};
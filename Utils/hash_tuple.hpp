@@ -24,7 +24,7 @@ struct hash
             return hash<decltype(tt.asTuple())>()(tt.asTuple());
         }
         else {
-            return std::hash<std::decay<TT>>()(tt);
+            return std::hash<std::decay_t<TT>>()(tt);
         }
     }
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// Fixed capacity key-value cache, the least recently used entry is evicted when it's full.
+// Hash and KeyEqual are used for the key lookup, e.g. hash_tuple::TupleHash<Key>::hash for descriptors.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class LRUCache
+{
+public:
+    explicit LRUCache(size_t capacity) : mCapacity(capacity > 0 ? capacity : 1) {}
+
+    // returns nullptr if the key is not cached, otherwise marks the entry as most recently used
+    Value* find(const Key& key)
+    {
+        auto it = mLookup.find(key);
+        if (it == mLookup.end()) return nullptr;
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return &it->second->second;
+    }
+
+    // inserts or replaces the entry of the key as the most recently used one
+    Value& insert(const Key& key, Value value)
+    {
+        auto it = mLookup.find(key);
+        if (it != mLookup.end()) {
+            it->second->second = std::move(value);
+            mEntries.splice(mEntries.begin(), mEntries, it->second);
+            return it->second->second;
+        }
+        mEntries.emplace_front(key, std::move(value));
+        mLookup.emplace(mEntries.front().first, mEntries.begin());
+        evict();
+        return mEntries.front().second;
+    }
+
+    void clear()
+    {
+        mLookup.clear();
+        mEntries.clear();
+    }
+
+    size_t size() const { return mEntries.size(); }
+    size_t capacity() const { return mCapacity; }
+    void setCapacity(size_t capacity)
+    {
+        mCapacity = capacity > 0 ? capacity : 1;
+        evict();
+    }
+
+private:
+    using Entry = std::pair<Key, Value>;
+
+    void evict()
+    {
+        while (mEntries.size() > mCapacity) {
+            mLookup.erase(mEntries.back().first);
+            mEntries.pop_back();
+        }
+    }
+
+    size_t mCapacity;
+    std::list<Entry> mEntries; // most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash, KeyEqual> mLookup;
+};